@@ -0,0 +1,429 @@
+/*
+ * Name:    cpxfbbt.h
+ * Author:  Pietro Belotti
+ * Purpose: declarations shared by the fix point FBBT driver and callbacks
+ *
+ * This code is published under the Eclipse Public License (EPL).
+ * See http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef CPXFBBT_H
+#define CPXFBBT_H
+
+#include <stdio.h>
+
+#include "cplex.h"
+
+/** \struct option_s
+ *  \brief options passed to the callbacks through their cbhandle
+ */
+
+struct option_s {
+
+  int frequency;    /**< Call the FBBT separator every frequency nodes      */
+  int maxDepth;     /**< Do not separate below this depth (-1: no limit)    */
+
+  char probe;       /**< Probe binary variables on the root FPLP            */
+  int  probeBudget; /**< Maximum simplex iterations spent on probing        */
+
+  int mfThreshold;  /**< Solve FPLPs with at least this many nonzeros
+		         matrix-free (-1: never)                          */
+  int mfIterations; /**< Iteration limit of the matrix-free solver        */
+  int nThreads;     /**< Threads used by the matrix-free solver           */
+
+  char diffGraph;    /**< Propagate difference rows with shortest paths,
+			  the other rows with the FPLP                     */
+
+  char cliqueTable;  /**< Propagate set packing and partitioning rows on a
+			  clique table, the other rows with the FPLP       */
+
+  double fplpMemory; /**< Budget (MB) of one FPLP, larger ones are solved
+			  in row chunks (<= 0: no limit)                   */
+  double rssCap;     /**< Keep the resident memory of the process below
+			  this (MB) when building FPLPs (<= 0: no cap)     */
+
+  int    fplpItLimit; /**< Simplex iterations of one separator call, FPLP
+			  construction included (< 0: no limit)            */
+  double fplpItTotal; /**< Same, for all separator calls (<= 0: no limit) */
+
+  int    rootRounds; /**< Max FPLP solves alternated with integer rounding
+			  at the root (1: single solve)                    */
+  double roundTime;  /**< Time limit (s) of the root rounding rounds      */
+
+  int heurFrequency;  /**< Run fix-and-propagate every this many heuristic
+			  callback calls (0: off)                          */
+  int heurBacktracks; /**< Maximum backtracks of one fix-and-propagate dive */
+
+  char targeted;    /**< Restrict the FPLP to candidate columns           */
+  int  targetHops;  /**< Rows within this many hops of the candidates     */
+  char targetCheck; /**< Also solve the full FPLP to count missed bounds  */
+
+  char pending;     /**< Keep non-violated tightenings for the subtree    */
+
+  char reduce;      /**< Fold fixed columns and drop redundant rows before
+			 building the FPLP                                */
+
+  char coefTighten; /**< Strengthen rows with the root fixpoint bounds    */
+
+  FILE *trace;      /**< If not NULL, record callback inputs here         */
+
+  struct budget_s *budget; /**< Work budget of the current separator call
+			        (NULL: none)                              */
+};
+
+/** \struct budget_s
+ *  \brief work budget of one separator call
+ */
+
+struct budget_s {
+
+  char   aborted; /**< The call ran out of budget                      */
+  double limit;   /**< Iterations left in this call (< 0: no limit)    */
+  double used;    /**< Iterations charged to this call                 */
+};
+
+/** \struct traceRec_s
+ *  \brief one callback call read from a trace
+ */
+
+struct traceRec_s {
+
+  int depth, ncols, nrows, nnz;
+
+  int    *mbeg, *mind; /**< rows of the node LP (mbeg has nrows+1 entries) */
+  double *mval;
+
+  char   *sense;       /**< senses, rhs and ranges as returned by Cplex    */
+  double *rhs, *rng;
+
+  double *lb, *ub, *x; /**< node bounds and node LP solution               */
+  char   *ctype;
+};
+
+/** \struct genModel_s
+ *  \brief synthetic MIP instance, rows in CSR form
+ */
+
+struct genModel_s {
+
+  int ncols, nrows, nnz;
+
+  int    *mbeg, *mind; /**< rows (mbeg has nrows+1 entries) */
+  double *mval, *rhs;
+  char   *sense;
+
+  double *obj, *lb, *ub;
+  char   *ctype;
+
+  int colcap, rowcap, nzcap; /**< allocated sizes */
+};
+
+int fixpointfbbt (CPXCENVptr env,
+		  void *cbdata,
+		  int wherefrom,
+		  void *cbhandle,
+		  int *useraction_p);
+
+void createRow (int sign,
+		int indexVar,
+		int nVars,
+		CPXLPptr p,
+		CPXCENVptr env,
+		const int *indices,
+		const double *coe,
+		double rhs,
+		const int nEl,
+		char extMod,
+		int indCon,
+		int nCon);
+
+CPXLPptr createFPLP (CPXCENVptr env,
+		     int ncols,
+		     int nrows,
+		     int nnz,
+		     const int *mbeg,
+		     const int *mind,
+		     const double *mval,
+		     const double *rlb,
+		     const double *rub,
+		     const double *lb,
+		     const double *ub,
+		     char extendedModel_);
+
+double fplpNumNz (int nrows,
+		  int nnz,
+		  const int *mbeg,
+		  const double *rlb,
+		  const double *rub);
+
+int mfFixpoint (int ncols,
+		int nrows,
+		int nnz,
+		const int *mbeg,
+		const int *mind,
+		const double *mval,
+		const double *rlb,
+		const double *rub,
+		const double *lb,
+		const double *ub,
+		double *sol,
+		int maxIter,
+		int nThreads);
+
+double fplpMemory (int ncols,
+		   int nrows,
+		   int nnz,
+		   const int *mbeg,
+		   const double *rlb,
+		   const double *rub);
+
+double fplpBudget (struct option_s *options);
+
+int chunkedFixpoint (CPXCENVptr env,
+		     int ncols,
+		     int nrows,
+		     int nnz,
+		     const int *mbeg,
+		     const int *mind,
+		     const double *mval,
+		     const double *rlb,
+		     const double *rub,
+		     const double *lb,
+		     const double *ub,
+		     double *sol,
+		     double budget,
+		     struct budget_s *work);
+
+void chunkStats (struct option_s *options);
+
+int diffFixpoint (CPXCENVptr env,
+		  struct option_s *options,
+		  int ncols,
+		  int nrows,
+		  int nnz,
+		  const int *mbeg,
+		  const int *mind,
+		  const double *mval,
+		  const double *rlb,
+		  const double *rub,
+		  const double *lb,
+		  const double *ub,
+		  double *sol);
+
+void diffStats ();
+
+int cliqueBounds (CPXCENVptr env,
+		  struct option_s *options,
+		  int ncols,
+		  int nrows,
+		  int nnz,
+		  const int *mbeg,
+		  const int *mind,
+		  const double *mval,
+		  const double *rlb,
+		  const double *rub,
+		  const char *ctype,
+		  const double *lb,
+		  const double *ub,
+		  double *sol);
+
+void cliqueStats ();
+
+int budgetStart (struct option_s *options, struct budget_s *b);
+
+int budgetBuild (struct budget_s *b, double nz);
+
+int budgetLPopt (CPXCENVptr env, CPXLPptr lp, struct budget_s *b);
+
+void *budgetHandle ();
+
+int budgetLPCallback (CPXCENVptr env,
+		      void *cbdata,
+		      int wherefrom,
+		      void *cbhandle);
+
+int budgetAborted (struct budget_s *b);
+
+void budgetEnd (struct budget_s *b, double time);
+
+void budgetStats (struct option_s *options);
+
+int rowBounds (int nrows,
+	       const char *sense,
+	       double *rlb,
+	       double *rub);
+
+int fixpointBounds (CPXCENVptr env,
+		    struct option_s *options,
+		    int ncols,
+		    int nrows,
+		    int nnz,
+		    const int *mbeg,
+		    const int *mind,
+		    const double *mval,
+		    const double *rlb,
+		    const double *rub,
+		    const double *lb,
+		    const double *ub,
+		    double *sol,
+		    CPXLPptr *fplp_p);
+
+int reducedBounds (CPXCENVptr env,
+		   struct option_s *options,
+		   int ncols,
+		   int nrows,
+		   int nnz,
+		   const int *mbeg,
+		   const int *mind,
+		   const double *mval,
+		   const double *rlb,
+		   const double *rub,
+		   const double *lb,
+		   const double *ub,
+		   double *sol);
+
+void reduceStats ();
+
+int coefTighten (CPXCENVptr env,
+		 void *cbdata,
+		 int wherefrom,
+		 CPXLPptr nodeLP,
+		 int ncols,
+		 int nrows,
+		 int nnz,
+		 const int *mbeg,
+		 const int *mind,
+		 const double *mval,
+		 const double *rlb,
+		 const double *rub,
+		 const char *ctype,
+		 const double *L,
+		 const double *U,
+		 struct budget_s *work);
+
+void coefStats ();
+
+FILE *traceOpen    (const char *filename, const char *mode);
+void  traceClose   (FILE *f);
+int   traceRead    (FILE *f, struct traceRec_s *rec);
+void  traceFreeRec (struct traceRec_s *rec);
+
+void traceWrite (FILE *f,
+		 int depth,
+		 int ncols,
+		 int nrows,
+		 int nnz,
+		 const int *mbeg,
+		 const int *mind,
+		 const double *mval,
+		 const char *sense,
+		 const double *rhs,
+		 const double *rng,
+		 const double *lb,
+		 const double *ub,
+		 const double *x,
+		 const char *ctype);
+
+int  genModel   (const char *type, int size, double density, unsigned int seed, struct genModel_s *m);
+void genWriteLP (FILE *f, const struct genModel_s *m);
+void genFree    (struct genModel_s *m);
+
+int fplpRoundingRounds (CPXCENVptr env,
+			CPXLPptr fplp,
+			int ncols,
+			const char *ctype,
+			double *sol,
+			int maxRounds,
+			double maxTime,
+			struct budget_s *work);
+
+int fixpropHeur (CPXCENVptr env,
+		 void *cbdata,
+		 int wherefrom,
+		 void *cbhandle,
+		 double *objval_p,
+		 double *x,
+		 int *checkfeas_p,
+		 int *useraction_p);
+
+int  cacheRootBounds (CPXCENVptr env, CPXLPptr lp, const char *dir, struct option_s *options, double *saved_p);
+void cacheStats      (const char *dir, int hit, double saved);
+
+int raceRun (int nWorkers,
+	     const char *model,
+	     const char *history,
+	     const char *names,
+	     char sweep,
+	     char *addcuts,
+	     int *presolve,
+	     struct option_s *opt);
+
+int daemonRun (const char *sockPath,
+	       int maxJobs,
+	       char *progName,
+	       int (*solve) (CPXENVptr env, int argc, char **argv));
+
+int targetedBounds (CPXCENVptr env,
+		    struct option_s *options,
+		    CPXCLPptr nodeLP,
+		    int ncols,
+		    int nrows,
+		    int nnz,
+		    const int *mbeg,
+		    const int *mind,
+		    const double *mval,
+		    const double *rlb,
+		    const double *rub,
+		    const double *lb,
+		    const double *ub,
+		    const char *ctype,
+		    const double *x,
+		    double *sol);
+
+void targetStats ();
+
+struct pending_s;
+
+struct pending_s *pendingStore (CPXCENVptr env, void *cbdata, int wherefrom, int depth);
+
+void pendingAdd (struct pending_s *p, int i, char lu, double bd);
+
+int pendingApply (CPXCENVptr env, void *cbdata, int wherefrom,
+		  struct pending_s *p, double *lb, double *ub, const double *x);
+
+int pendingBranch (CPXCENVptr env,
+		   void *cbdata,
+		   int wherefrom,
+		   void *cbhandle,
+		   int brtype,
+		   int sos,
+		   int nodecnt,
+		   int bdcnt,
+		   const int *nodebeg,
+		   const int *indices,
+		   const char *lu,
+		   const double *bd,
+		   const double *nodeest,
+		   int *useraction_p);
+
+void pendingDelete (CPXCENVptr env, int wherefrom, void *cbhandle, int seqnum, void *handle);
+
+void pendingStats ();
+
+int fplpProbe (CPXCENVptr env,
+	       void *cbdata,
+	       int wherefrom,
+	       CPXLPptr fplp,
+	       int ncols,
+	       int nnz,
+	       const int *mind,
+	       const char *ctype,
+	       const double *lb,
+	       const double *ub,
+	       const double *x,
+	       int budget,
+	       struct budget_s *work,
+	       int *useraction_p);
+
+#endif
@@ -0,0 +1,259 @@
+/*
+ * Fix point FBBT as a cutting plane in Cplex -- work budget
+ *
+ * Nothing bounds the simplex on a node FPLP, and one bad FPLP can stall
+ * the branch-and-bound for seconds. Each separator call gets a budget
+ * in simplex iterations (--fplpitlim), as does the whole run
+ * (--fplpittotal). Building an FPLP is charged one iteration per
+ * BUDGET_NZ_PER_IT nonzeros, before it is built; solving it is charged
+ * its simplex iterations, and an LP callback aborts the solve as soon
+ * as they exceed what is left. An aborted call adds no cuts, and the
+ * FPLPs it built are freed as for an infeasible one. The re-solves of
+ * root rounding, probing and coefficient tightening are charged the
+ * same way, and they stop once the call is over budget, keeping what
+ * they found so far.
+ *
+ * After k consecutive aborted calls, the next 2^k - 1 calls are
+ * skipped; once the run's budget is spent, all of them are.
+ *
+ * The budget of a call is a struct budget_s owned by the call and
+ * passed down with its options, so that calls in different threads do
+ * not share it. The LP callback is shared by all solves in the
+ * environment: its handle is the list of FPLPs being solved, and it
+ * finds the budget of the solve by its thread.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <pthread.h>
+
+#include "cplex.h"
+#include "cpxfbbt.h"
+
+#define BUDGET_NZ_PER_IT 1000.
+#define BUDGET_MAXBACKOFF 10
+#define BUDGET_MAXSOLVES 64
+
+/** \struct budgetSolves_s
+ *  \brief FPLPs being solved within a budget, one per thread
+ */
+
+struct budgetSolves_s {
+
+  pthread_mutex_t lock;
+
+  int n;
+
+  pthread_t        thread [BUDGET_MAXSOLVES];
+  struct budget_s *budget [BUDGET_MAXSOLVES];
+};
+
+static struct budgetSolves_s solves_ = {PTHREAD_MUTEX_INITIALIZER, 0};
+
+// run-wide counters, under solves_. lock
+
+static int
+  nAborts_   = 0, // calls aborted
+  nSkipped_  = 0, // calls skipped after aborts or with the run's budget spent
+  nInRow_    = 0, // consecutive aborted calls
+  toSkip_    = 0; // calls still to skip
+
+static double
+  usedTotal_ = 0., // iterations charged to all calls
+  wasted_    = 0.; // time spent in aborted calls
+
+/* start the budget of a separator call in b. Returns false if the call
+   should be skipped */
+
+int budgetStart (struct option_s *options, struct budget_s *b) {
+
+  int start = 1;
+
+  double left;
+
+  pthread_mutex_lock (&solves_. lock);
+
+  left = (options -> fplpItTotal > 0.) ? options -> fplpItTotal - usedTotal_ : -1.;
+
+  if ((options -> fplpItTotal > 0.) && (left <= 0.)) {
+    ++nSkipped_;
+    start = 0;
+  } else if (toSkip_ > 0) {
+    --toSkip_;
+    ++nSkipped_;
+    start = 0;
+  }
+
+  pthread_mutex_unlock (&solves_. lock);
+
+  b -> limit = options -> fplpItLimit;
+
+  if ((left > 0.) && ((b -> limit < 0.) || (left < b -> limit)))
+    b -> limit = left;
+
+  b -> aborted = 0;
+  b -> used    = 0.;
+
+  return start;
+}
+
+/* charge work iterations to the call of b. Returns false if the call
+   is over budget */
+
+static int budgetCharge (struct budget_s *b, double work) {
+
+  if (!b)
+    return 1;
+
+  b -> used += work;
+
+  pthread_mutex_lock (&solves_. lock);
+  usedTotal_ += work;
+  pthread_mutex_unlock (&solves_. lock);
+
+  if ((b -> limit >= 0.) && (b -> used > b -> limit))
+    b -> aborted = 1;
+
+  return !b -> aborted;
+}
+
+/* charge the construction of an FPLP with nz nonzeros, before it is
+   built. Returns false if it should not be */
+
+int budgetBuild (struct budget_s *b, double nz) {
+
+  return !budgetAborted (b) && budgetCharge (b, nz / BUDGET_NZ_PER_IT);
+}
+
+/* CPXlpopt on an FPLP, within the budget b of the current call (none
+   if NULL). Fails if the call is over budget once the FPLP is solved,
+   even if it was solved to optimality: its iterations are only known
+   afterwards */
+
+int budgetLPopt (CPXCENVptr env, CPXLPptr lp, struct budget_s *b) {
+
+  int status, k = -1;
+
+  if (!b)
+    return CPXlpopt (env, lp);
+
+  if (b -> aborted)
+    return CPXERR_CALLBACK; // don't even start
+
+  // let the LP callback find b
+
+  pthread_mutex_lock (&solves_. lock);
+
+  if (solves_. n < BUDGET_MAXSOLVES) {
+    k = solves_. n++;
+    solves_. thread [k] = pthread_self ();
+    solves_. budget [k] = b;
+  }
+
+  pthread_mutex_unlock (&solves_. lock);
+
+  status = CPXlpopt (env, lp);
+
+  pthread_mutex_lock (&solves_. lock);
+
+  for (k=0; k<solves_. n; k++)
+    if (solves_. budget [k] == b) {
+      --solves_. n;
+      solves_. thread [k] = solves_. thread [solves_. n];
+      solves_. budget [k] = solves_. budget [solves_. n];
+      break;
+    }
+
+  pthread_mutex_unlock (&solves_. lock);
+
+  if (!budgetCharge (b, CPXgetitcnt (env, lp)))
+    return CPXERR_CALLBACK;
+
+  return status;
+}
+
+/* handle of the LP callback */
+
+void *budgetHandle () {
+
+  return &solves_;
+}
+
+/* LP callback: abort the FPLP being solved once its iterations exceed
+   what is left of the budget of its call */
+
+int budgetLPCallback (CPXCENVptr env,
+		      void *cbdata,
+		      int wherefrom,
+		      void *cbhandle) {
+
+  struct budgetSolves_s *solves = (struct budgetSolves_s *) cbhandle;
+  struct budget_s *b = NULL;
+
+  int k, itcnt;
+
+  pthread_mutex_lock (&solves -> lock);
+
+  for (k=0; k<solves -> n; k++)
+    if (pthread_equal (solves -> thread [k], pthread_self ())) {
+      b = solves -> budget [k];
+      break;
+    }
+
+  pthread_mutex_unlock (&solves -> lock);
+
+  if (!b || (b -> limit < 0.) ||
+      CPXgetcallbackinfo (env, cbdata, wherefrom, CPX_CALLBACK_INFO_ITCOUNT, &itcnt))
+    return 0;
+
+  return (b -> used + itcnt > b -> limit);
+}
+
+/* true if the call of b ran out of budget */
+
+int budgetAborted (struct budget_s *b) {
+
+  return b && b -> aborted;
+}
+
+/* end the budget b of a call that took time seconds, and back off
+   after an abort */
+
+void budgetEnd (struct budget_s *b, double time) {
+
+  if (!b)
+    return;
+
+  pthread_mutex_lock (&solves_. lock);
+
+  if (b -> aborted) {
+
+    ++nAborts_;
+    wasted_ += time;
+
+    if (nInRow_ < BUDGET_MAXBACKOFF)
+      ++nInRow_;
+
+    toSkip_ = (1 << nInRow_) - 1;
+
+  } else nInRow_ = 0;
+
+  pthread_mutex_unlock (&solves_. lock);
+}
+
+/* print the statistics of the work budget, and start them over */
+
+void budgetStats (struct option_s *options) {
+
+  printf ("FPLP budget: %d calls aborted, %d skipped, %g s wasted, %g iterations used",
+	  nAborts_, nSkipped_, wasted_, usedTotal_);
+
+  if (options -> fplpItTotal > 0.)
+    printf (" of %g", options -> fplpItTotal);
+
+  printf ("\n");
+
+  nAborts_ = nSkipped_ = nInRow_ = toSkip_ = 0;
+  usedTotal_ = wasted_ = 0.;
+}
@@ -0,0 +1,180 @@
+/*
+ * Fix point FBBT -- FPLP construction microbenchmark
+ *
+ * For each instance type and each target FPLP size (powers of ten of
+ * nonzeros between --minnz and --maxnz), a synthetic instance is
+ * scaled until its FPLP has about the target number of nonzeros, and
+ * the time spent in createFPLP alone is measured. One line per run:
+ *
+ * buildbench: type,size,ncols,nrows,nnz,fplprows,fplpnz,time,rows/s,nnz/s,maxrss
+ *
+ * where maxrss is the peak resident set size of the process so far
+ * (kB). Runs are in increasing size, so it tracks the largest FPLP.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "cplex.h"
+#include "cmdline.h"
+#include "cpxfbbt.h"
+
+#define MAX_SCALING_STEPS 8
+
+static double wallTime () {
+
+  struct timeval tv;
+  gettimeofday (&tv, NULL);
+  return (double) tv. tv_sec + (double) tv. tv_usec / 1e6;
+}
+
+/* row bounds of an instance, as computed in the callback */
+
+static void genRowBounds (const struct genModel_s *m, double *rlb, double *rub) {
+
+  memcpy (rlb, m -> rhs, m -> nrows * sizeof (double));
+  memset (rub, 0,        m -> nrows * sizeof (double));
+
+  rowBounds (m -> nrows, m -> sense, rlb, rub);
+}
+
+static void benchType (CPXENVptr env, const char *type, double density, int seed, double minNz, double maxNz) {
+
+  double target;
+
+  int size = 100;
+
+  for (target = minNz; target <= maxNz; target *= 10.) {
+
+    struct genModel_s m;
+    struct rusage usage;
+
+    CPXLPptr fplp;
+
+    double *rlb, *rub, est = 0., time0;
+
+    int step;
+
+    // scale the instance until the FPLP has about target nonzeros
+
+    for (step = 0; step < MAX_SCALING_STEPS; step++) {
+
+      if (genModel (type, size, density, (unsigned int) seed, &m))
+	return;
+
+      rlb = (double *) malloc ((m.nrows + 1) * sizeof (double));
+      rub = (double *) malloc ((m.nrows + 1) * sizeof (double));
+
+      genRowBounds (&m, rlb, rub);
+
+      est = fplpNumNz (m.nrows, m.nnz, m.mbeg, rlb, rub);
+
+      if (((est >= target / 2.) && (est <= target * 2.)) ||
+	  (step == MAX_SCALING_STEPS - 1))
+	break;
+
+      size = (int) (size * ((est > 0.) ? target / est : 10.));
+
+      if (size < 1)
+	size = 1;
+
+      free (rlb);
+      free (rub);
+      genFree (&m);
+    }
+
+    time0 = wallTime ();
+    fplp  = createFPLP (env, m.ncols, m.nrows, m.nnz, m.mbeg, m.mind, m.mval, rlb, rub, m.lb, m.ub, 0);
+    time0 = wallTime () - time0;
+
+    if (!fplp) {
+      free (rlb);
+      free (rub);
+      genFree (&m);
+      break;
+    }
+
+    if (getrusage (RUSAGE_SELF, &usage))
+      usage.ru_maxrss = -1;
+
+    printf ("buildbench: %s,%d,%d,%d,%d,%d,%lld,%g,%g,%g,%ld\n",
+	    type, size, m.ncols, m.nrows, m.nnz,
+	    CPXgetnumrows (env, fplp),
+	    (long long) CPXLgetnumnz (env, fplp),
+	    time0,
+	    (time0 > 0.) ? CPXgetnumrows (env, fplp) / time0 : -1.,
+	    (time0 > 0.) ? (double) CPXLgetnumnz (env, fplp) / time0 : -1.,
+	    (long) usage.ru_maxrss);
+
+    fflush (stdout);
+
+    CPXfreeprob (env, &fplp);
+
+    free (rlb);
+    free (rub);
+    genFree (&m);
+  }
+}
+
+int main (int argc, char **argv) {
+
+  const char *types [] = {"knapsack", "cover", "lotsizing", "block", NULL};
+
+  int status, i, seed;
+
+  double density, minNz, maxNz;
+
+  char
+    ifHelp = 0,
+    **filenames,
+    *type = (char *) malloc (sizeof (char));
+
+  CPXENVptr env;
+
+  tpar options [] = {{ 'y',  CSTR() "type",       0, &type,    TSTRING, CSTR() "Instance type: knapsack, cover, lotsizing, block (default: all)"}
+		     ,{'r',  CSTR() "density", 0.05, &density, TDOUBLE, CSTR() "Row density (default: 0.05)"}
+		     ,{'s',  CSTR() "seed",       1, &seed,    TINT,    CSTR() "Random seed (default: 1)"}
+		     ,{'m',  CSTR() "minnz",    1e3, &minNz,   TDOUBLE,    CSTR() "Smallest FPLP size, in nonzeros (default: 1000)"}
+		     ,{'M',  CSTR() "maxnz",    1e7, &maxNz,   TDOUBLE,    CSTR() "Largest FPLP size, in nonzeros (default: 10000000)"}
+		     ,{'h',  CSTR() "help",       0, &ifHelp,  TTOGGLE, CSTR() "Print this help and exit"}
+		     ,{0,    CSTR() "",           0, NULL,     TTOGGLE, CSTR() ""} // THIS ENTRY ALWAYS AT THE END
+  };
+
+  set_default_args (options);
+
+  filenames = readargs (argc, argv, options);
+
+  if (filenames) {
+    for (i=0; filenames [i]; ++i)
+      free (filenames [i]);
+    free (filenames);
+  }
+
+  if (ifHelp) {
+    print_help (argv [0], options);
+    free (type);
+    return 0;
+  }
+
+  env = CPXopenCPLEX (&status);
+
+  if (!env) {
+    printf ("Could not open Cplex, error code %d\n", status);
+    free (type);
+    return -1;
+  }
+
+  for (i=0; types [i]; i++)
+    if (!*type || !strcmp (type, types [i]))
+      benchType (env, types [i], density, seed, minNz, maxNz);
+
+  CPXcloseCPLEX (&env);
+
+  free (type);
+
+  return 0;
+}
@@ -0,0 +1,462 @@
+/*
+ * Fix point FBBT as a cutting plane in Cplex -- on-disk cache of root
+ * fixpoint bounds
+ *
+ * The model (matrix, rhs and ranges, senses, bounds and column types)
+ * is hashed into a 64-bit fingerprint, and the rounded root fixpoint
+ * bounds are kept in <dir>/<fingerprint>.fpc:
+ *
+ *   char   magic [4]  "FPBC"
+ *   int    version
+ *   uint64 fingerprint
+ *   int    ncols
+ *   double time       time taken to compute the bounds
+ *   double lb [ncols], ub [ncols]
+ *   uint64 checksum   of all of the above
+ *
+ * A file whose header, size, checksum or bounds do not match is
+ * ignored (and overwritten). <dir>/stats holds the number of lookups,
+ * hits, and the total time saved, and <dir>/stats.lock serializes its
+ * updates.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <sys/time.h>
+#include <sys/file.h>
+
+#include "cplex.h"
+#include "cpxfbbt.h"
+
+#define COUENNE_EPS 1e-5
+
+#define CACHE_MAGIC   "FPBC"
+#define CACHE_VERSION 1
+
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME  1099511628211ULL
+
+static double wallTime () {
+
+  struct timeval tv;
+  gettimeofday (&tv, NULL);
+  return (double) tv. tv_sec + (double) tv. tv_usec / 1e6;
+}
+
+static unsigned long long hashBytes (unsigned long long h, const void *ptr, size_t n) {
+
+  const unsigned char *p = (const unsigned char *) ptr;
+
+  while (n--)
+    h = (h ^ *p++) * FNV_PRIME;
+
+  return h;
+}
+
+/* fingerprint of the model in lp */
+
+static unsigned long long modelFingerprint (CPXCENVptr env, CPXCLPptr lp) {
+
+  int
+    ncols = CPXgetnumcols (env, lp),
+    nrows = CPXgetnumrows (env, lp),
+    nnz   = CPXgetnumnz   (env, lp),
+    suffspace,
+    *mbeg = (int    *) malloc ((1 + nrows) * sizeof (int)),
+    *mind = (int    *) malloc ((1 + nnz)   * sizeof (int));
+
+  double
+    *mval = (double *) malloc ((1 + nnz)   * sizeof (double)),
+    *rhs  = (double *) malloc ((1 + nrows) * sizeof (double)),
+    *rng  = (double *) malloc ((1 + nrows) * sizeof (double)),
+    *lb   = (double *) malloc ((1 + ncols) * sizeof (double)),
+    *ub   = (double *) malloc ((1 + ncols) * sizeof (double));
+
+  char
+    *sense = (char *) malloc ((1 + nrows) * sizeof (char)),
+    *ctype = (char *) malloc ((1 + ncols) * sizeof (char));
+
+  unsigned long long h = FNV_OFFSET;
+
+  if (nrows) {
+    CPXgetrows   (env, lp, &nnz, mbeg, mind, mval, nnz, &suffspace, 0, nrows-1);
+    CPXgetrhs    (env, lp, rhs,   0, nrows-1);
+    CPXgetrngval (env, lp, rng,   0, nrows-1);
+    CPXgetsense  (env, lp, sense, 0, nrows-1);
+  }
+
+  if (ncols) {
+    CPXgetlb (env, lp, lb, 0, ncols-1);
+    CPXgetub (env, lp, ub, 0, ncols-1);
+
+    if (CPXgetctype (env, lp, ctype, 0, ncols-1)) // no integers
+      memset (ctype, CPX_CONTINUOUS, ncols);
+  }
+
+  h = hashBytes (h, &ncols, sizeof (int));
+  h = hashBytes (h, &nrows, sizeof (int));
+  h = hashBytes (h, &nnz,   sizeof (int));
+  h = hashBytes (h, mbeg,   nrows * sizeof (int));
+  h = hashBytes (h, mind,   nnz   * sizeof (int));
+  h = hashBytes (h, mval,   nnz   * sizeof (double));
+  h = hashBytes (h, rhs,    nrows * sizeof (double));
+  h = hashBytes (h, rng,    nrows * sizeof (double));
+  h = hashBytes (h, sense,  nrows * sizeof (char));
+  h = hashBytes (h, lb,     ncols * sizeof (double));
+  h = hashBytes (h, ub,     ncols * sizeof (double));
+  h = hashBytes (h, ctype,  ncols * sizeof (char));
+
+  free (mbeg);
+  free (mind);
+  free (mval);
+  free (rhs);
+  free (rng);
+  free (lb);
+  free (ub);
+  free (sense);
+  free (ctype);
+
+  return h;
+}
+
+/* read the cached bounds for key into lb and ub. Returns 1 if the file
+   exists and is valid */
+
+static int cacheLoad (const char *filename,
+		      unsigned long long key,
+		      int ncols,
+		      double *lb,
+		      double *ub,
+		      double *time_p) {
+
+  FILE *f = fopen (filename, "rb");
+
+  char magic [4];
+
+  int
+    i, ok,
+    version = 0,
+    n       = -1;
+
+  unsigned long long
+    fKey  = 0,
+    fSum  = 0,
+    check = FNV_OFFSET;
+
+  if (!f)
+    return 0;
+
+  ok =
+    (fread (magic,    1,                           4, f) == 4) &&
+    (fread (&version, sizeof (int),                1, f) == 1) &&
+    (fread (&fKey,    sizeof (unsigned long long), 1, f) == 1) &&
+    (fread (&n,       sizeof (int),                1, f) == 1) &&
+    !strncmp (magic, CACHE_MAGIC, 4) &&
+    (version == CACHE_VERSION) &&
+    (fKey    == key) &&
+    (n       == ncols) &&
+    (fread (time_p, sizeof (double),             1,     f) == 1)     &&
+    (fread (lb,     sizeof (double),             ncols, f) == ncols) &&
+    (fread (ub,     sizeof (double),             ncols, f) == ncols) &&
+    (fread (&fSum,  sizeof (unsigned long long), 1,     f) == 1)     &&
+    (fgetc (f) == EOF);
+
+  fclose (f);
+
+  if (!ok)
+    return 0;
+
+  check = hashBytes (check, magic,    4);
+  check = hashBytes (check, &version, sizeof (int));
+  check = hashBytes (check, &fKey,    sizeof (unsigned long long));
+  check = hashBytes (check, &n,       sizeof (int));
+  check = hashBytes (check, time_p,   sizeof (double));
+  check = hashBytes (check, lb,       ncols * sizeof (double));
+  check = hashBytes (check, ub,       ncols * sizeof (double));
+
+  if (check != fSum)
+    return 0;
+
+  for (i=0; i<ncols; i++)
+    if (!(lb [i] <= ub [i])) // also catches NaNs
+      return 0;
+
+  return 1;
+}
+
+/* write the bounds for key, through a temporary file so that a
+   concurrent reader never sees a partial file */
+
+static void cacheStore (const char *filename,
+			unsigned long long key,
+			int ncols,
+			const double *lb,
+			const double *ub,
+			double time) {
+
+  char *tmpname = (char *) malloc ((strlen (filename) + 32) * sizeof (char));
+
+  int
+    ok,
+    version = CACHE_VERSION;
+
+  unsigned long long check = FNV_OFFSET;
+
+  FILE *f;
+
+  sprintf (tmpname, "%s.%d", filename, (int) getpid ());
+
+  if (!(f = fopen (tmpname, "wb"))) {
+    printf ("Could not write cache file %s\n", tmpname);
+    free (tmpname);
+    return;
+  }
+
+  check = hashBytes (check, CACHE_MAGIC, 4);
+  check = hashBytes (check, &version,    sizeof (int));
+  check = hashBytes (check, &key,        sizeof (unsigned long long));
+  check = hashBytes (check, &ncols,      sizeof (int));
+  check = hashBytes (check, &time,       sizeof (double));
+  check = hashBytes (check, lb,          ncols * sizeof (double));
+  check = hashBytes (check, ub,          ncols * sizeof (double));
+
+  ok =
+    (fwrite (CACHE_MAGIC, 1,                           4,     f) == 4)     &&
+    (fwrite (&version,    sizeof (int),                1,     f) == 1)     &&
+    (fwrite (&key,        sizeof (unsigned long long), 1,     f) == 1)     &&
+    (fwrite (&ncols,      sizeof (int),                1,     f) == 1)     &&
+    (fwrite (&time,       sizeof (double),             1,     f) == 1)     &&
+    (fwrite (lb,          sizeof (double),             ncols, f) == ncols) &&
+    (fwrite (ub,          sizeof (double),             ncols, f) == ncols) &&
+    (fwrite (&check,      sizeof (unsigned long long), 1,     f) == 1);
+
+  if (fclose (f) || !ok ||
+      rename (tmpname, filename)) {
+
+    printf ("Could not write cache file %s\n", filename);
+    remove (tmpname);
+  }
+
+  free (tmpname);
+}
+
+/* root fixpoint bounds of the model in lp, rounded for integer
+   columns. Returns 1 if they are valid */
+
+static int rootBounds (CPXCENVptr env,
+		       CPXCLPptr lp,
+		       struct option_s *options,
+		       double *newLB,
+		       double *newUB) {
+
+  int
+    i, suffspace, solved = 0,
+    ncols = CPXgetnumcols (env, lp),
+    nrows = CPXgetnumrows (env, lp),
+    nnz   = CPXgetnumnz   (env, lp),
+    *mbeg = (int    *) malloc ((1 + nrows) * sizeof (int)),
+    *mind = (int    *) malloc ((1 + nnz)   * sizeof (int));
+
+  double
+    *mval = (double *) malloc ((1 + nnz)   * sizeof (double)),
+    *rlb  = (double *) malloc ((1 + nrows) * sizeof (double)),
+    *rub  = (double *) malloc ((1 + nrows) * sizeof (double)),
+    *lb   = (double *) malloc ((1 + ncols) * sizeof (double)),
+    *ub   = (double *) malloc ((1 + ncols) * sizeof (double)),
+    *sol  = (double *) malloc ((1 + 2 * ncols) * sizeof (double));
+
+  char
+    *sense = (char *) malloc ((1 + nrows) * sizeof (char)),
+    *ctype = (char *) malloc ((1 + ncols) * sizeof (char));
+
+  CPXLPptr fplp = NULL;
+
+  if (nrows && ncols &&
+      !CPXgetrows   (env, lp, &nnz, mbeg, mind, mval, nnz, &suffspace, 0, nrows-1) &&
+      !CPXgetrhs    (env, lp, rlb,   0, nrows-1) &&
+      !CPXgetrngval (env, lp, rub,   0, nrows-1) &&
+      !CPXgetsense  (env, lp, sense, 0, nrows-1) &&
+      !CPXgetlb     (env, lp, lb,    0, ncols-1) &&
+      !CPXgetub     (env, lp, ub,    0, ncols-1) &&
+      !rowBounds    (nrows, sense, rlb, rub)) {
+
+    if (CPXgetctype (env, lp, ctype, 0, ncols-1)) // no integers
+      memset (ctype, CPX_CONTINUOUS, ncols);
+
+    solved = fixpointBounds (env, options, ncols, nrows, nnz, mbeg, mind, mval, rlb, rub, lb, ub, sol, &fplp);
+  }
+
+  if (fplp)
+    CPXfreeprob (env, &fplp);
+
+  if (solved)
+
+    for (i=0; i<ncols; i++) {
+
+      newLB [i] = sol [i];
+      newUB [i] = sol [ncols + i];
+
+      if ((CPX_BINARY  == ctype [i]) ||
+	  (CPX_INTEGER == ctype [i])) {
+
+	newLB [i] = ceil  (newLB [i] - COUENNE_EPS);
+	newUB [i] = floor (newUB [i] + COUENNE_EPS);
+      }
+
+      // never loosen the model's bounds
+
+      if (newLB [i] < lb [i]) newLB [i] = lb [i];
+      if (newUB [i] > ub [i]) newUB [i] = ub [i];
+
+      if (newLB [i] > newUB [i]) // infeasible: leave it to Cplex
+	solved = 0;
+    }
+
+  free (mbeg);
+  free (mind);
+  free (mval);
+  free (rlb);
+  free (rub);
+  free (lb);
+  free (ub);
+  free (sol);
+  free (sense);
+  free (ctype);
+
+  return solved;
+}
+
+/* look up the root fixpoint bounds of the model in lp in cache
+   directory dir, computing and storing them on a miss, and tighten
+   the model's bounds with them. Returns 1 on a hit and sets *saved_p
+   to the time the bounds originally took */
+
+int cacheRootBounds (CPXCENVptr env,
+		     CPXLPptr lp,
+		     const char *dir,
+		     struct option_s *options,
+		     double *saved_p) {
+
+  unsigned long long key = modelFingerprint (env, lp);
+
+  int
+    i, hit, valid, nChg = 0,
+    ncols = CPXgetnumcols (env, lp),
+    *ind  = (int    *) malloc ((1 + 2 * ncols) * sizeof (int));
+
+  char
+    *lu       = (char *) malloc ((1 + 2 * ncols) * sizeof (char)),
+    *filename = (char *) malloc ((strlen (dir) + 32) * sizeof (char));
+
+  double
+    time0 = wallTime (),
+    *newLB = (double *) malloc ((1 + ncols) * sizeof (double)),
+    *newUB = (double *) malloc ((1 + ncols) * sizeof (double)),
+    *oldLB = (double *) malloc ((1 + ncols) * sizeof (double)),
+    *oldUB = (double *) malloc ((1 + ncols) * sizeof (double)),
+    *bd    = (double *) malloc ((1 + 2 * ncols) * sizeof (double));
+
+  *saved_p = 0.;
+
+  sprintf (filename, "%s/%016llx.fpc", dir, key);
+
+  valid = hit = cacheLoad (filename, key, ncols, newLB, newUB, saved_p);
+
+  if (!hit &&
+      (valid = rootBounds (env, lp, options, newLB, newUB)))
+    cacheStore (filename, key, ncols, newLB, newUB, wallTime () - time0);
+
+  if (valid && ncols) {
+
+    CPXgetlb (env, lp, oldLB, 0, ncols-1);
+    CPXgetub (env, lp, oldUB, 0, ncols-1);
+
+    for (i=0; i<ncols; i++) {
+      if (newLB [i] > oldLB [i] + COUENNE_EPS) {ind [nChg] = i; lu [nChg] = 'L'; bd [nChg++] = newLB [i];}
+      if (newUB [i] < oldUB [i] - COUENNE_EPS) {ind [nChg] = i; lu [nChg] = 'U'; bd [nChg++] = newUB [i];}
+    }
+
+    if (nChg)
+      CPXchgbds (env, lp, nChg, ind, lu, bd);
+  }
+
+  if (hit)
+    *saved_p -= wallTime () - time0; // net of the lookup
+
+  printf ("Cache %s for %016llx: %d root bounds tightened\n", hit ? "hit" : "miss", key, nChg);
+
+  free (ind);
+  free (lu);
+  free (filename);
+  free (newLB);
+  free (newUB);
+  free (oldLB);
+  free (oldUB);
+  free (bd);
+
+  return hit;
+}
+
+/* add this run to the counters in dir/stats and print them. The file
+   is locked while it is updated, and replaced rather than rewritten,
+   so that concurrent runs neither lose nor tear each other's counts */
+
+void cacheStats (const char *dir, int hit, double saved) {
+
+  char
+    *filename = (char *) malloc ((strlen (dir) + 16) * sizeof (char)),
+    *tmpname  = (char *) malloc ((strlen (dir) + 48) * sizeof (char));
+
+  int
+    lock,
+    lookups = 0,
+    hits    = 0;
+
+  double totSaved = 0.;
+
+  FILE *f;
+
+  sprintf (filename, "%s/stats.lock", dir);
+
+  if ((lock = open (filename, O_RDWR | O_CREAT, 0644)) >= 0)
+    flock (lock, LOCK_EX);
+
+  sprintf (filename, "%s/stats",    dir);
+  sprintf (tmpname,  "%s/stats.%d", dir, (int) getpid ());
+
+  if ((f = fopen (filename, "r"))) {
+
+    if (fscanf (f, "%d %d %lf", &lookups, &hits, &totSaved) != 3) {
+      lookups = hits = 0;
+      totSaved = 0.;
+    }
+
+    fclose (f);
+  }
+
+  ++lookups;
+  hits     += hit;
+  totSaved += saved;
+
+  if ((f = fopen (tmpname, "w"))) {
+
+    int ok = (fprintf (f, "%d %d %g\n", lookups, hits, totSaved) > 0);
+
+    if (fclose (f) || !ok ||
+	rename (tmpname, filename))
+      remove (tmpname);
+  }
+
+  if (lock >= 0)
+    close (lock); // releases the lock
+
+  printf ("Cache: %s,%g,%d,%d,%g,%g\n", hit ? "hit" : "miss", saved, lookups, hits, (double) hits / lookups, totSaved);
+
+  free (filename);
+  free (tmpname);
+}
@@ -4,12 +4,14 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 #include <sys/time.h>
 #include "cplex.h"
 
 #include "cmdline.h"
+#include "cpxfbbt.h"
 
 //#define DEBUG
 
@@ -21,25 +23,6 @@
 #define DBL_MAX 1e50
 #define COUENNE_INFINITY 1e50
 
-struct option_s {
-
-  int frequency;
-  int maxDepth;
-};
-
-extern void createRow (int sign,
-		       int indexVar,
-		       int nVars,
-		       CPXLPptr p,
-		       CPXCENVptr env,
-		       const int *indices,
-		       const double *coe,
-		       double rhs,
-		       const int nEl,
-		       char extMod,
-		       int indCon,
-		       int nCon);
-
 int fixpointfbbt (CPXCENVptr env,
 		  void *cbdata,
 		  int wherefrom,
@@ -58,11 +41,10 @@ int fixpointfbbt (CPXCENVptr env,
     nnz,
     *mbeg,
     *mind,
-    *ind,
     ncols,
     nrows,
     suffspace,
-    i,j,
+    i,
     depth;
 
   double 
@@ -73,13 +55,24 @@ int fixpointfbbt (CPXCENVptr env,
     *rub,
     *lb,
     *ub,
-    *coe,
+    *newLB,
+    *newUB,
+    *x,
     time0;
 
   char
-    *sense, extendedModel_ = 0;
+    *sense,
+    solved;
+
+  struct pending_s *pend = NULL;
 
-  static char firstCall_ = true;
+  int pendCuts = 0;
+
+  static char
+    firstCall_ = true,
+    probed_    = false, // root probing already done
+    tightened_ = false, // root rows already strengthened
+    mismatch_  = false; // warned about the node LP and callback LP differing
 
   static int  
     nRuns_ = 0, // number of calls 
@@ -88,7 +81,11 @@ int fixpointfbbt (CPXCENVptr env,
 
   static double cpuTime_ = 0.;
 
-  struct option_s *options = (struct option_s *) cbdata;
+  struct option_s
+    *options = (struct option_s *) cbhandle,
+    callOpt; // options of this call, with its own work budget
+
+  struct budget_s budget;
 
   {
     struct timeval tv;
@@ -102,6 +99,14 @@ int fixpointfbbt (CPXCENVptr env,
 
     //printf ("ran %d times, tightened %d lower and %d upper bounds, sep time: %g\n", nRuns_, nTiL_, nTiU_, cpuTime_);
     printf ("%g,%d,-1,-1,-1,-1,-1,", cpuTime_, nRuns_);
+
+    // the next run (a daemon job) starts afresh
+
+    firstCall_ = true;
+    probed_ = tightened_ = mismatch_ = false;
+    nRuns_ = nTiL_ = nTiU_ = 0;
+    cpuTime_ = 0.;
+
     return 0;
   }
 
@@ -123,11 +128,44 @@ int fixpointfbbt (CPXCENVptr env,
 
   //printf ("fixpt callback... "); fflush (stdout);
 
+  // with MIPCBREDLP on (see main), this is the presolved model, whose
+  // columns are those of the node LP. Column types are read from it, so
+  // make sure it is so and do nothing otherwise
+
   status = CPXgetcallbacklp (env, cbdata, wherefrom, &origLP);
 
   char *ctype;
 
   ncols = CPXgetnumcols (env, nodeLP);
+
+  if (status || (CPXgetnumcols (env, origLP) != ncols)) {
+
+    if (!mismatch_)
+      printf ("Warning: node LP and callback LP have different columns, no FBBT\n");
+
+    mismatch_ = true;
+    return 0;
+  }
+
+  // out of budget, or backing off after aborted calls
+
+  callOpt        = *options;
+  callOpt.budget = NULL;
+
+  if ((options -> fplpItLimit >= 0) || (options -> fplpItTotal > 0.)) {
+
+    if (!budgetStart (options, &budget))
+      return 0;
+
+    callOpt.budget = &budget;
+  }
+
+  // root rounding and probing need the full FPLP, which the graph of
+  // difference rows would not return
+
+  if (!depth && ((options -> rootRounds > 1) || options -> probe))
+    callOpt.diffGraph = 0;
+
   nrows = CPXgetnumrows (env, nodeLP);
   nnz   = CPXgetnumnz   (env, nodeLP);
 
@@ -142,6 +180,7 @@ int fixpointfbbt (CPXCENVptr env,
 
   sense  = (char   *) malloc (     nrows  * sizeof (char));
   ctype  = (char   *) malloc (     ncols  * sizeof (char));
+  x      = (double *) malloc (     ncols  * sizeof (double)); // solution to the node LP
 
   rlb = rhs;
   rub = rng;
@@ -152,29 +191,16 @@ int fixpointfbbt (CPXCENVptr env,
   //status = CPXgetlb    (env, nodeLP, lb,    0, ncols-1);
   //status = CPXgetub    (env, nodeLP, ub,    0, ncols-1);
 
-  status = CPXgetrhs   (env, nodeLP, rhs,   0, nrows-1);
-  status = CPXgetsense (env, nodeLP, sense, 0, nrows-1);
+  status = CPXgetrhs    (env, nodeLP, rhs,   0, nrows-1);
+  status = CPXgetrngval (env, nodeLP, rng,   0, nrows-1);
+  status = CPXgetsense  (env, nodeLP, sense, 0, nrows-1);
 
   //if (status) printf ("status:%d\n", status);
 
-  status = CPXgetctype (env, origLP, ctype, 0, ncols-1);
-
-  //if (status) printf ("=> status:%d\n", status);
-
-  /* translate rng, rhs into rlb, rub ************************************/
-
-  for (i=0; i<nrows; ++i)
+  // no column types (an LP, or an error): round no bound
 
-    switch (sense [i]) {
-
-    case 'L': rub [i] = rhs [i]; rlb [i] = -DBL_MAX; break; /* [a,0] --> [-inf, a]    */
-    case 'E': rub [i] = rhs [i];                     break; /* [a,0] --> [a,    a]    */
-    case 'G': rub [i] = DBL_MAX;                     break; /* [a,0] --> [a,    +inf] */
-    case 'R': rub [i] += rlb [i];                    break; /* [a,b] --> [a,    a+b]  */
-
-    default: printf ("Constraint %d has undefined sense\n", i); 
-      exit (-1); 
-    }
+  if (CPXgetctype (env, origLP, ctype, 0, ncols-1))
+    memset (ctype, CPX_CONTINUOUS, ncols * sizeof (char));
 
   status = CPXgetrows (env, nodeLP, &nnz, mbeg, mind, mval, nnz, &suffspace, 0, nrows - 1);
 
@@ -188,188 +214,63 @@ int fixpointfbbt (CPXCENVptr env,
     exit (-1);
   }
 
-  //x = (double *) malloc (ncols * sizeof (double));
-
-  if (firstCall_) 
-    firstCall_ = false;
-
-  //  double startTime = CoinCpuTime ();
-
-  //printf ("Fixed Point FBBT: "); fflush (stdout);
-
-  ++nRuns_;
-
-  /******************************************************************
+  status = CPXgetcallbacknodex (env, cbdata, wherefrom, x, 0, ncols-1); 
 
-    An LP relaxation of a MINLP problem is available. Let us suppose
-    that this LP relaxation is of the form
+  if (options -> trace)
+    traceWrite (options -> trace, depth, ncols, nrows, nnz, mbeg, mind, mval, sense, rhs, rng, lb, ub, x, ctype);
 
-    LP = {x in R^n: Ax <= b}
- 
-    for suitable nxm matrix A, rhs vector b, and variable vector
-    x. Our purpose is that of creating a much larger LP that will
-    help us find the interval [l,u] corresponding to the fixpoint of
-    an FBBT algorithm. To this purpose, consider a single constraint
-    of the above system:
+  // bounds proven earlier in this subtree tighten the FPLP's input, and
+  // if they cut off x there is no need for a new FPLP
 
-    sum {i=1..n} a_ji x_i <= b_j
+  if (options -> pending &&
+      (pend = pendingStore (env, cbdata, wherefrom, depth)))
+    pendCuts = pendingApply (env, cbdata, wherefrom, pend, lb, ub, x);
 
-    According to two schools of thought (Leo's and mine), this
-    single constraint can give rise to a number of FBBT
-    constraints. The two schools of thoughts differ in the meaning
-    of b: in mine, it is constant. In Leo's, it is a variable.
-
-    We need to perform the following steps:
-
-    define variables xL and xU
-    define variables gL and gU for constraints (downward variables)
-
-    add objective function sum_j (u_j - l_j)
-
-    for each constraint a^j x <= b_j in Ax <= b:
-    for each variable x_i contained:
-    depending on sign of a_ji, add constraint on x_i^L or x_i^U
-    (*) add constraints on g_j as well
-
-    solve LP
-
-    If new bounds are better than si's old bounds
-    add OsiColCuts
-
-    PS: We prove in the paper that our schools of thought are very
-    close, and the only two people between them are Fourier and
-    Motzkin
-
-  ******************************************************************/
-
-  /// Get the original problem's coefficient matrix and rhs vector, A and b
-
-  fplp = CPXcreateprob (env, &status, "FixPointLP");
-
-#ifdef DEBUG
-  for (i=0; i<ncols; i++) 
-    printf ("----------- x_%d in [%g,%g]\n", i, lb [i], ub [i]);
-#endif
-
-  double
-    plus_one  =  1.,
-    minus_one = -1.,
-    zero      =  0.,
-    pInf      =  DBL_MAX,
-    mInf      = -DBL_MAX;
-
-  // add lvars and uvars to the new problem
-  for (i=0; i<ncols; i++)   status = CPXnewcols (env, fplp, 1, &minus_one, lb + i, ub + i, NULL, NULL); /*fplp -> addCol (0, NULL, NULL, lb [i], ub [i], -1.); // xL_i*/
-  for (i=0; i<ncols; i++)   status = CPXnewcols (env, fplp, 1,  &plus_one, lb + i, ub + i, NULL, NULL); /*fplp -> addCol (0, NULL, NULL, lb [i], ub [i], +1.); // xU_i*/
-
-  if (extendedModel_) {
-
-    for (j=0; j<nrows; j++) status = CPXnewcols (env, fplp, 1, &zero, rlb + j, &pInf, NULL, NULL); /*fplp -> addCol (0, NULL, NULL, rlb [j],      DBL_MAX, 0.); // bL_j*/
-    for (j=0; j<nrows; j++) status = CPXnewcols (env, fplp, 1, &zero, &mInf, rub + j, NULL, NULL); /*fplp -> addCol (0, NULL, NULL, -DBL_MAX, rub [j],     0.); // bU_j*/
-  }
-
-  // Scan each row of the matrix 
-
-  coe = mval;
-  ind = mind;
-
-  for (j=0; j<nrows; j++) { // for each row
-
-    //printf ("checking mbeg[%d]-mbeg[%d]\n", j+1, j);
-    //printf ("--> %d-%d\n", mbeg[j+1], mbeg[j]);
-
-    int nEl = (j==nrows-1) ? (nnz - mbeg [j]) : (mbeg [j+1] - mbeg [j]);
-
-    if (!nEl)
-      continue;
-
-#ifdef DEBUG
-
-    printf ("row %4d, %4d elements: ", j, nEl);
-
-    for (i=0; i<nEl; i++) {
-      printf ("%+g x%d ", coe [i], ind [i]);
-      fflush (stdout);
-    }
-
-    printf ("in [%g,%g]\n", rlb [j], rub [j]);
-#endif
-
-    // create cuts for the xL and xU elements //////////////////////
-
-    if (extendedModel_ || (rlb [j] > -COUENNE_INFINITY))
-      for (i=0; i<nEl; i++) 
-	createRow (-1, ind [i], ncols, fplp, env, ind, coe, rlb [j], nEl, extendedModel_, j, nrows); // downward constraints -- on x_i
-
-    if (extendedModel_ || (rub [j] <  COUENNE_INFINITY))
-      for (i=0; i<nEl; i++) 
-	createRow (+1, ind [i], ncols, fplp, env, ind, coe, rub [j], nEl, extendedModel_, j, nrows); // downward constraints -- on x_i
-
-    // create (at most 2) cuts for the bL and bU elements //////////////////////
-
-    if (extendedModel_) {
-      createRow (-1, 2*ncols         + j, ncols, fplp, env, ind, coe, rlb [j], nEl, extendedModel_, j, nrows); // upward constraints -- on bL_i
-      createRow (+1, 2*ncols + nrows + j, ncols, fplp, env, ind, coe, rub [j], nEl, extendedModel_, j, nrows); // upward constraints -- on bU_i
-    }
-
-    ind += nEl;
-    coe += nEl;
-  }
-
-  // finally, add consistency cuts, bL <= bU
-
-  if (extendedModel_)
-
-    for (j=0; j<nrows; j++) { // for each row
+  /* translate rng, rhs into rlb, rub ************************************/
 
-      int    ind [2] = {2*ncols + j, 2*ncols + nrows + j};
-      double coe [2] = {1.,      -1.};
-      int    beg [2] = {0,2};
-      char sense = 'L';
+  if (rowBounds (nrows, sense, rlb, rub))
+    exit (-1);
 
-      status = CPXaddrows (env, fplp, 0, 1, 2, &zero, &sense, beg, ind, coe, NULL, NULL);
-    }
+  if (firstCall_) 
+    firstCall_ = false;
 
-  /// Now we have an fbbt-fixpoint LP problem. Solve it to get
-  /// (possibly) better bounds
+  //  double startTime = CoinCpuTime ();
 
-  status = CPXchgobjsen (env, fplp, CPX_MAX);
+  //printf ("Fixed Point FBBT: "); fflush (stdout);
 
-#ifdef DEBUG
-  {
-    char fplpname [10];
-    sprintf (fplpname, "fplp-%d.lp", nRuns_);
-    printf ("(writing lp %s) ", fplpname);
-    status = CPXwriteprob (env, fplp, fplpname, NULL);
-  }
-#endif
+  ++nRuns_;
 
-                                   //  /|-----------+
-  status = CPXlpopt (env, fplp);   // < |           |
-                                   //  \|-----------+
+  newLB = (double *) malloc (2 * ncols * sizeof (double));
+  newUB = newLB + ncols;
 
-  status = CPXgetstat (env, fplp);
+  fplp   = NULL;
+  solved = false;
 
   *useraction_p = CPX_CALLBACK_DEFAULT;
 
-  if (status == CPX_STAT_OPTIMAL) {
+  if (pendCuts > 0)
+    *useraction_p = CPX_CALLBACK_SET;
+  else if (options -> targeted)
+    solved = targetedBounds (env, &callOpt, nodeLP, ncols, nrows, nnz, mbeg, mind, mval, rlb, rub, lb, ub, ctype, x, newLB);
+  else if (options -> cliqueTable && (depth || ((options -> rootRounds <= 1) && !options -> probe)))
+    solved = cliqueBounds (env, &callOpt, ncols, nrows, nnz, mbeg, mind, mval, rlb, rub, ctype, lb, ub, newLB);
+  else if (options -> reduce && (depth || ((options -> rootRounds <= 1) && !options -> probe))) // root rounding and probing need the full FPLP
+    solved = reducedBounds (env, &callOpt, ncols, nrows, nnz, mbeg, mind, mval, rlb, rub, lb, ub, newLB);
+  else
+    solved = fixpointBounds (env, &callOpt, ncols, nrows, nnz, mbeg, mind, mval, rlb, rub, lb, ub, newLB, &fplp);
 
-    // if problem not solved to optimality, bounds are useless
+  if (solved) {
 
     double 
-      *newLB = (double *) malloc (2 * ncols * sizeof (double)),
-      *newUB,
       *oldLB = lb,
       *oldUB = ub,
-      newbd = 1.,
-      *x = (double *) malloc (ncols * sizeof (double)); // solution to the node LP
-
+      newbd = 1.;
 
-    status = CPXgetcallbacknodex (env, cbdata, wherefrom, x, 0, ncols-1); 
+    // at the root, let rounding of integer bounds propagate through
+    // the same FPLP before turning bounds into cuts
 
-    status = CPXgetx (env, fplp, newLB, 0, 2 * ncols - 1);
-
-    newUB = newLB + ncols;
+    if (fplp && !depth && (options -> rootRounds > 1))
+      fplpRoundingRounds (env, fplp, ncols, ctype, newLB, options -> rootRounds, options -> roundTime, callOpt.budget);
 
     // check old and new bounds
 
@@ -388,6 +289,13 @@ int fixpointfbbt (CPXCENVptr env,
       if (status)
 	printf ("status:%d\n", status);
 
+      // keep the others for the subtree
+
+      if (pend) {
+	if ((newLB [i] <= x [i] + COUENNE_EPS) && (newLB [i] > oldLB [i] + COUENNE_EPS)) pendingAdd (pend, i, 'L', newLB [i]);
+	if ((newUB [i] >= x [i] - COUENNE_EPS) && (newUB [i] < oldUB [i] - COUENNE_EPS)) pendingAdd (pend, i, 'U', newUB [i]);
+      }
+
 #define DEBUG
 #ifdef DEBUG
       if (((newLB [i] > x [i] + COUENNE_EPS) && (newLB [i] > oldLB [i] + COUENNE_EPS))  ||
@@ -398,10 +306,22 @@ int fixpointfbbt (CPXCENVptr env,
 #endif
     }
 
-    free (x);
-    free (newLB);
+    // at the root, probe binaries on the same FPLP (only once)
+
+    if (fplp && options -> probe && !depth && !probed_ && !budgetAborted (callOpt.budget)) {
+      probed_ = true;
+      fplpProbe (env, cbdata, wherefrom, fplp, ncols, nnz, mind, ctype, lb, ub, x, options -> probeBudget, callOpt.budget, useraction_p);
+    }
+
+    // at the root, strengthen big-M rows with the fixpoint bounds (only once)
+
+    if (options -> coefTighten && !depth && !tightened_) {
+      tightened_ = true;
+      if (coefTighten (env, cbdata, wherefrom, nodeLP, ncols, nrows, nnz, mbeg, mind, mval, rlb, rub, ctype, newLB, newUB, callOpt.budget) > 0)
+	*useraction_p = CPX_CALLBACK_SET;
+    }
 
-  } else printf ("FPLP infeasible or unbounded.\n");
+  } else if ((pendCuts <= 0) && !budgetAborted (callOpt.budget)) printf ("FPLP infeasible or unbounded.\n");
 
   if ((options -> frequency < 0) && 
       (0 == nTiL_ + nTiU_) &&
@@ -409,8 +329,11 @@ int fixpointfbbt (CPXCENVptr env,
 
     options -> frequency = 0;
 
-  CPXfreeprob (env, &fplp);
+  if (fplp)
+    CPXfreeprob (env, &fplp);
 
+  free (newLB);
+  free (x);
   free (mbeg);
   free (mind);
   free (mval);
@@ -427,6 +350,7 @@ int fixpointfbbt (CPXCENVptr env,
     struct timeval tv;
     gettimeofday (&tv, NULL);
     cpuTime_ += ((double) tv. tv_sec + (double) tv. tv_usec / 1e6 - time0);
+    budgetEnd (callOpt.budget, (double) tv. tv_sec + (double) tv. tv_usec / 1e6 - time0);
     //printf ("%g this call\n", (double) tv. tv_sec + (double) tv. tv_usec / 1e6 - time0);
   }
 
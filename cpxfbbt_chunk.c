@@ -0,0 +1,365 @@
+/*
+ * Fix point FBBT as a cutting plane in Cplex -- memory-bounded FPLP
+ *
+ * The FPLP has one row per nonzero and finite row side, each with as
+ * many elements as the original row, and can take much more memory
+ * than the MIP. Its size is estimated before it is built; if it is
+ * over budget, the rows are split into chunks whose FPLPs fit, and the
+ * chunk FPLPs are solved in a block Gauss-Seidel loop: each one on its
+ * own columns, with bounds from the previous chunks, until a sweep
+ * over all chunks tightens nothing.
+ *
+ * Each iterate is valid: the fixpoint of all rows is a fixpoint of the
+ * rows of a chunk, hence it is contained in the optimum of the chunk
+ * FPLP (see cpxfbbt_mfsolve.c). At convergence the box is a fixpoint
+ * of every chunk, i.e., the fixpoint of the full FPLP. A row whose FPLP
+ * alone is over budget is left out, which only weakens the bounds.
+ *
+ * The budget is the smaller of --fplpmem and what is left under
+ * --rsscap given the current resident memory of the process.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include <sys/resource.h>
+
+#include "cplex.h"
+#include "cpxfbbt.h"
+
+#define COUENNE_EPS 1e-5
+#define COUENNE_INFINITY 1e50
+
+#define CHUNK_MAXSWEEPS 50
+
+// rough cost in bytes of an FPLP element in Cplex, with the copies kept
+// by the simplex
+
+#define FPLP_BYTES_NZ  40.
+#define FPLP_BYTES_ROW 100.
+#define FPLP_BYTES_COL 100.
+
+static int
+  nCalls_    = 0, // chunked FPLPs
+  nChunks_   = 0, // chunks
+  nSweeps_   = 0, // Gauss-Seidel sweeps
+  nSkipped_  = 0, // rows over budget on their own
+  nOverCap_  = 0; // FPLPs not solved at all, as the process was over the cap
+
+/* memory taken by the FPLP of row j (with at most 2 nEl new columns) */
+
+static double rowMemory (int j,
+			 int nrows,
+			 int nnz,
+			 const int *mbeg,
+			 const double *rlb,
+			 const double *rub) {
+
+  double
+    nEl   = (j==nrows-1) ? (nnz - mbeg [j]) : (mbeg [j+1] - mbeg [j]),
+    sides = (rlb [j] > -COUENNE_INFINITY) + (rub [j] < COUENNE_INFINITY);
+
+  return sides * nEl * (nEl * FPLP_BYTES_NZ + FPLP_BYTES_ROW) + 2. * nEl * FPLP_BYTES_COL;
+}
+
+/* estimated memory (bytes) of the FPLP of the given rows */
+
+double fplpMemory (int ncols,
+		   int nrows,
+		   int nnz,
+		   const int *mbeg,
+		   const double *rlb,
+		   const double *rub) {
+
+  double
+    mem = 2. * ncols * FPLP_BYTES_COL;
+
+  int j;
+
+  for (j=0; j<nrows; j++) {
+
+    double nEl = (j==nrows-1) ? (nnz - mbeg [j]) : (mbeg [j+1] - mbeg [j]);
+
+    if (rlb [j] > -COUENNE_INFINITY) mem += nEl * (nEl * FPLP_BYTES_NZ + FPLP_BYTES_ROW);
+    if (rub [j] <  COUENNE_INFINITY) mem += nEl * (nEl * FPLP_BYTES_NZ + FPLP_BYTES_ROW);
+  }
+
+  return mem;
+}
+
+/* memory budget (bytes) of one FPLP, -1 if unlimited */
+
+double fplpBudget (struct option_s *options) {
+
+  double budget = (options -> fplpMemory > 0.) ? options -> fplpMemory * 1048576. : -1.;
+
+  if (options -> rssCap > 0.) {
+
+    long pages = 0, rss = 0;
+
+    FILE *f = fopen ("/proc/self/statm", "r");
+
+    if (f) {
+      if (fscanf (f, "%ld %ld", &pages, &rss) < 2)
+	rss = 0;
+      fclose (f);
+    }
+
+    double left = options -> rssCap * 1048576. - (double) rss * sysconf (_SC_PAGESIZE);
+
+    if (left < 0.)
+      left = 0.;
+
+    if ((budget < 0.) || (left < budget))
+      budget = left;
+  }
+
+  return budget;
+}
+
+/* fixpoint bounds of the given rows and column bounds into sol (xL,
+   then xU), solving FPLPs of at most budget bytes each, within the work
+   budget of the call (none if NULL). Returns true if the bounds in sol
+   are valid */
+
+int chunkedFixpoint (CPXCENVptr env,
+		     int ncols,
+		     int nrows,
+		     int nnz,
+		     const int *mbeg,
+		     const int *mind,
+		     const double *mval,
+		     const double *rlb,
+		     const double *rub,
+		     const double *lb,
+		     const double *ub,
+		     double *sol,
+		     double budget,
+		     struct budget_s *work) {
+
+  int
+    i, j, p, c, sweep,
+    nChunks  = 0,
+    maxRows  = 0,
+    maxNz    = 0,
+    feasible = 1,
+    tick     = 0,
+    *chunkBeg = (int *) malloc ((2 + nrows) * sizeof (int)), // first row of each chunk
+    *colMap   = (int *) malloc ((1 + ncols) * sizeof (int)), // column to chunk column
+    *stamp    = (int *) malloc ((1 + ncols) * sizeof (int)), // last chunk that mapped a column
+    *subCol   = (int *) malloc ((1 + ncols) * sizeof (int)), // chunk column to column
+    *lastChg  = (int *) malloc ((1 + ncols) * sizeof (int)), // tick of the last tightening of a column
+    *solvedAt,                                               // tick of the last solve of a chunk
+    *smbeg, *smind;
+
+  char *skip = (char *) calloc (nrows + 1, sizeof (char));
+
+  double
+    mem = 0.,
+    *smval, *srlb, *srub, *slb, *sub, *ssol;
+
+  memcpy (sol,         lb, ncols * sizeof (double));
+  memcpy (sol + ncols, ub, ncols * sizeof (double));
+
+  if (budget <= 0.) {
+
+    ++nOverCap_;
+
+    free (chunkBeg); free (colMap); free (stamp); free (subCol); free (lastChg);
+    free (skip);
+    return 0;
+  }
+
+  // split rows into consecutive chunks within budget
+
+  {
+    int cRows = 0, cNz = 0;
+
+    for (j=0; j<nrows; j++) {
+
+      double rMem = rowMemory (j, nrows, nnz, mbeg, rlb, rub);
+
+      int nEl = ((j==nrows-1) ? nnz : mbeg [j+1]) - mbeg [j];
+
+      if ((rMem > budget) || !nEl) {
+
+	if (nEl) {
+	  skip [j] = 1;
+	  ++nSkipped_;
+	}
+
+	continue;
+      }
+
+      if (!nChunks || (mem + rMem > budget)) {
+
+	chunkBeg [nChunks++] = j;
+	mem = cRows = cNz = 0;
+      }
+
+      mem += rMem;
+
+      if (++cRows       > maxRows) maxRows = cRows;
+      if ((cNz += nEl) > maxNz)    maxNz   = cNz;
+    }
+
+    chunkBeg [nChunks] = nrows;
+  }
+
+  ++nCalls_;
+  nChunks_ += nChunks;
+
+  smbeg = (int    *) malloc ((1 + maxRows) * sizeof (int));
+  smind = (int    *) malloc ((1 + maxNz)   * sizeof (int));
+  smval = (double *) malloc ((1 + maxNz)   * sizeof (double));
+  srlb  = (double *) malloc ((1 + maxRows) * sizeof (double));
+  srub  = (double *) malloc ((1 + maxRows) * sizeof (double));
+  slb   = (double *) malloc ((1 + maxNz)   * sizeof (double));
+  sub   = (double *) malloc ((1 + maxNz)   * sizeof (double));
+  ssol  = (double *) malloc ((1 + 2 * maxNz) * sizeof (double));
+
+  solvedAt = (int *) malloc ((1 + nChunks) * sizeof (int));
+
+  for (i=0; i<ncols; i++)
+    stamp [i] = lastChg [i] = -1;
+
+  for (c=0; c<nChunks; c++)
+    solvedAt [c] = -2;
+
+  for (sweep = 0; feasible && (sweep < CHUNK_MAXSWEEPS); sweep++) {
+
+    int nTight = 0;
+
+    for (c=0; c<nChunks; c++) {
+
+      int
+	sncols = 0,
+	snrows = 0,
+	snnz   = 0,
+	dirty  = (solvedAt [c] < -1),
+	id     = sweep * nChunks + c;
+
+      CPXLPptr fplp;
+
+      // nothing to do if no bound of the chunk changed since it was solved
+
+      for (j = chunkBeg [c]; !dirty && (j < chunkBeg [c+1]); j++)
+	for (p = mbeg [j]; p < ((j==nrows-1) ? nnz : mbeg [j+1]); p++)
+	  if (lastChg [mind [p]] > solvedAt [c]) {
+	    dirty = 1;
+	    break;
+	  }
+
+      if (!dirty)
+	continue;
+
+      // chunk rows and columns, with the current bounds
+
+      for (j = chunkBeg [c]; j < chunkBeg [c+1]; j++) {
+
+	int end = (j==nrows-1) ? nnz : mbeg [j+1];
+
+	if (skip [j] || (end == mbeg [j]))
+	  continue;
+
+	srlb  [snrows]   = rlb [j];
+	srub  [snrows]   = rub [j];
+	smbeg [snrows++] = snnz;
+
+	for (p = mbeg [j]; p < end; p++) {
+
+	  i = mind [p];
+
+	  if (stamp [i] != id) {
+	    stamp  [i] = id;
+	    colMap [i] = sncols;
+	    subCol [sncols] = i;
+	    slb [sncols]   = sol [i];
+	    sub [sncols++] = sol [ncols + i];
+	  }
+
+	  smind [snnz]   = colMap [i];
+	  smval [snnz++] = mval [p];
+	}
+      }
+
+      if (!snrows)
+	continue;
+
+      fplp = budgetBuild (work, fplpNumNz (snrows, snnz, smbeg, srlb, srub)) ?
+	createFPLP (env, sncols, snrows, snnz, smbeg, smind, smval, srlb, srub, slb, sub, 0) : NULL;
+
+      solvedAt [c] = ++tick;
+
+      if (fplp &&
+	  !budgetLPopt (env, fplp, work) &&
+	  (CPXgetstat (env, fplp) == CPX_STAT_OPTIMAL) &&
+	  !CPXgetx (env, fplp, ssol, 0, 2 * sncols - 1)) {
+
+	for (p=0; p<sncols; p++) {
+
+	  i = subCol [p];
+
+	  if (ssol [p] > sol [i] + COUENNE_EPS * (1. + fabs (sol [i]))) {
+	    sol [i] = ssol [p];
+	    lastChg [i] = tick;
+	    ++nTight;
+	  }
+
+	  if (ssol [sncols + p] < sol [ncols + i] - COUENNE_EPS * (1. + fabs (sol [ncols + i]))) {
+	    sol [ncols + i] = ssol [sncols + p];
+	    lastChg [i] = tick;
+	    ++nTight;
+	  }
+	}
+
+      } else feasible = 0; // as for the full FPLP, no bounds
+
+      if (fplp)
+	CPXfreeprob (env, &fplp);
+
+      if (!feasible)
+	break;
+    }
+
+    ++nSweeps_;
+
+    if (!nTight)
+      break;
+  }
+
+  free (chunkBeg); free (colMap); free (stamp); free (subCol); free (lastChg);
+  free (solvedAt);
+  free (skip);
+  free (smbeg);    free (smind);  free (smval);
+  free (srlb);     free (srub);
+  free (slb);      free (sub);    free (ssol);
+
+  return feasible && nChunks;
+}
+
+/* print the statistics of the chunked FPLPs, and start them over */
+
+void chunkStats (struct option_s *options) {
+
+  struct rusage usage;
+
+  getrusage (RUSAGE_SELF, &usage);
+
+  printf ("Chunked FPLP: %d calls, %g chunks/call, %g sweeps/call, %d rows over budget, %d calls over the cap, peak RSS %g MB",
+	  nCalls_,
+	  nCalls_ ? (double) nChunks_ / nCalls_ : 0.,
+	  nCalls_ ? (double) nSweeps_ / nCalls_ : 0.,
+	  nSkipped_, nOverCap_,
+	  usage. ru_maxrss / 1024.);
+
+  if (options -> rssCap > 0.)
+    printf (" (cap %g MB)", options -> rssCap);
+
+  printf ("\n");
+
+  nCalls_ = nChunks_ = nSweeps_ = nSkipped_ = nOverCap_ = 0;
+}
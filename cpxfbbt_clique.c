@@ -0,0 +1,424 @@
+/*
+ * Fix point FBBT as a cutting plane in Cplex -- clique rows
+ *
+ * Set packing and partitioning rows, sum_{k in K} x_k <= 1 (or = 1)
+ * with binary x, are the worst case of the FPLP: each of them becomes
+ * nEl FPLP rows of nEl elements. Their propagation is trivial, though:
+ *
+ *   U_k <= 1 - sum_{h in K, h != k} L_h
+ *   L_k >= 1 - sum_{h in K, h != k} U_h   (partitioning only)
+ *
+ * i.e., once a column is at one the others are at zero, and in a
+ * partitioning row the last column not at zero is at one. These rows
+ * are kept out of the FPLP and propagated with a clique table, the list
+ * of clique rows of each column, from a queue of the rows whose columns
+ * changed. A row whose lower bounds sum above one (or upper bounds
+ * below one, for partitioning) is infeasible.
+ *
+ * The other rows go to the FPLP (reduced as in cpxfbbt_reduce.c with
+ * --reduce), and the two are alternated as in cpxfbbt_diff.c until
+ * neither tightens anything: the result is the fixpoint of all rows.
+ * Rows are classified with the column types, so this is called by the
+ * callback and the replay tool rather than from fixpointBounds.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <sys/time.h>
+
+#include "cplex.h"
+#include "cpxfbbt.h"
+
+#define COUENNE_EPS 1e-5
+#define COUENNE_INFINITY 1e50
+
+#define CLIQUE_MAXROUNDS 50
+#define CLIQUE_MAXVISITS 100 // average visits of a clique row in one propagation
+
+static int
+  nCalls_   = 0,
+  nClique_  = 0, // rows handled by the clique table
+  nPart_    = 0, // ... of which partitioning
+  nRounds_  = 0, // clique/FPLP alternations
+  nInfeas_  = 0; // infeasible clique rows found
+
+static double
+  fullRows_ = 0., restRows_ = 0., // FPLP rows and nonzeros without and with the clique table
+  fullNz_   = 0., restNz_   = 0.,
+  cliqueTime_ = 0.,
+  fplpTime_   = 0.;
+
+static double wallTime () {
+
+  struct timeval tv;
+  gettimeofday (&tv, NULL);
+  return (double) tv. tv_sec + (double) tv. tv_usec / 1e6;
+}
+
+/* number of FPLP rows of the given rows, one per finite side */
+
+static double fplpRows (int nrows, const double *rlb, const double *rub) {
+
+  double n = 0.;
+  int j;
+
+  for (j=0; j<nrows; j++)
+    n += (rlb [j] > -COUENNE_INFINITY) + (rub [j] < COUENNE_INFINITY);
+
+  return n;
+}
+
+/* propagate the clique rows (cbeg, cind, part) on the bounds L and U
+   from the n rows in queue (marked in inQueue), with the clique table
+   (tbeg, trow). Returns the number of bounds changed, -1 if a row is
+   infeasible */
+
+static int propagateCliques (int nClq,
+			     const int *cbeg,
+			     const int *cind,
+			     const char *part,
+			     const int *tbeg,
+			     const int *trow,
+			     double *L,
+			     double *U,
+			     int *queue,
+			     int n,
+			     char *inQueue) {
+
+  int
+    qHead  = 0,
+    nChg   = 0,
+    visits = 0;
+
+  while (n && (visits++ < CLIQUE_MAXVISITS * nClq)) {
+
+    int p, q, r = queue [qHead];
+
+    double sumL = 0., sumU = 0.;
+
+    qHead = (qHead + 1) % nClq;
+    --n;
+    inQueue [r] = 0;
+
+    for (p = cbeg [r]; p < cbeg [r+1]; p++) {
+      sumL += L [cind [p]];
+      sumU += U [cind [p]];
+    }
+
+    if ((sumL > 1. + COUENNE_EPS) ||
+	(part [r] && (sumU < 1. - COUENNE_EPS)))
+      return -1;
+
+    for (p = cbeg [r]; p < cbeg [r+1]; p++) {
+
+      int
+	k   = cind [p],
+	chg = 0;
+
+      double
+	nu = 1. - (sumL - L [k]),
+	nl = 1. - (sumU - U [k]);
+
+      if (nu < U [k] - COUENNE_EPS) {
+	U [k] = nu;
+	chg = 1;
+      }
+
+      if (part [r] && (nl > L [k] + COUENNE_EPS)) {
+	L [k] = nl;
+	chg = 1;
+      }
+
+      if (!chg)
+	continue;
+
+      if (L [k] > U [k] + COUENNE_EPS)
+	return -1;
+
+      ++nChg;
+
+      for (q = tbeg [k]; q < tbeg [k+1]; q++)
+	if (!inQueue [trow [q]]) {
+	  inQueue [trow [q]] = 1;
+	  queue [(qHead + n++) % nClq] = trow [q];
+	}
+    }
+  }
+
+  return nChg;
+}
+
+/* fixpoint bounds of the given rows and column bounds into sol (xL,
+   then xU), with the set packing and partitioning rows on binary
+   columns propagated on a clique table and the others by the
+   FPLP. Returns true if the bounds in sol are valid */
+
+int cliqueBounds (CPXCENVptr env,
+		  struct option_s *options,
+		  int ncols,
+		  int nrows,
+		  int nnz,
+		  const int *mbeg,
+		  const int *mind,
+		  const double *mval,
+		  const double *rlb,
+		  const double *rub,
+		  const char *ctype,
+		  const double *lb,
+		  const double *ub,
+		  double *sol) {
+
+  int
+    i, j, p, round,
+    nClq = 0, cnnz = 0,
+    rrows = 0, rnnz = 0,
+    valid = 1,
+    *cbeg, *cind, *tbeg, *tpos, *trow, *rbeg, *rind, *queue;
+
+  double
+    *rval, *rrlb, *rrub, *fsol;
+
+  char
+    *kind = (char *) malloc ((1 + nrows) * sizeof (char)), // 0: FPLP, 1: packing, 2: partitioning
+    *chg  = (char *) malloc ((1 + ncols) * sizeof (char)), // bound changed by the FPLP
+    *part, *inQueue;
+
+  CPXLPptr fplp = NULL;
+
+  // classify rows: all coefficients equal to a, binary columns, and
+  // a x in [l,u] with u/a = 1 and l/a either 1 or not above 0
+
+  for (j=0; j<nrows; j++) {
+
+    int
+      first = mbeg [j],
+      nEl   = ((j==nrows-1) ? nnz : mbeg [j+1]) - first;
+
+    double
+      a  = nEl ? mval [first] : 0.,
+      lo = (a > 0.) ? rlb [j] : -rub [j],
+      up = (a > 0.) ? rub [j] : -rlb [j];
+
+    kind [j] = 0;
+
+    if ((nEl >= 2) && (a != 0.) &&
+	(fabs (up) < COUENNE_INFINITY) &&
+	(fabs (up / fabs (a) - 1.) <= COUENNE_EPS) &&
+	((lo <= 0.) || (fabs (lo / fabs (a) - 1.) <= COUENNE_EPS))) {
+
+      for (p = first; p < first + nEl; p++) {
+
+	i = mind [p];
+
+	if ((fabs (mval [p] - a) > COUENNE_EPS * fabs (a)) ||
+	    ((CPX_BINARY  != ctype [i]) &&
+	     (CPX_INTEGER != ctype [i])) ||
+	    (lb [i] < -COUENNE_EPS) ||
+	    (ub [i] > 1. + COUENNE_EPS))
+	  break;
+      }
+
+      if (p == first + nEl)
+	kind [j] = (lo > 0.) ? 2 : 1;
+    }
+
+    if (kind [j]) {
+      ++nClq;
+      cnnz += nEl;
+    } else {
+      ++rrows;
+      rnnz += nEl;
+    }
+  }
+
+  if (!nClq) { // no clique rows, the usual FPLP
+
+    free (kind);
+    free (chg);
+
+    valid = options -> reduce ?
+      reducedBounds  (env, options, ncols, nrows, nnz, mbeg, mind, mval, rlb, rub, lb, ub, sol) :
+      fixpointBounds (env, options, ncols, nrows, nnz, mbeg, mind, mval, rlb, rub, lb, ub, sol, &fplp);
+
+    if (fplp)
+      CPXfreeprob (env, &fplp);
+
+    return valid;
+  }
+
+  // clique rows, and the clique table: the clique rows of each column
+
+  cbeg = (int  *) malloc ((2 + nClq)  * sizeof (int));
+  cind = (int  *) malloc ((1 + cnnz)  * sizeof (int));
+  part = (char *) malloc ((1 + nClq)  * sizeof (char));
+  tbeg = (int  *) calloc ((2 + ncols),  sizeof (int));
+  tpos = (int  *) malloc ((1 + ncols) * sizeof (int));
+  trow = (int  *) malloc ((1 + cnnz)  * sizeof (int));
+
+  // other rows, for the FPLP
+
+  rbeg = (int    *) malloc ((1 + rrows) * sizeof (int));
+  rind = (int    *) malloc ((1 + rnnz)  * sizeof (int));
+  rval = (double *) malloc ((1 + rnnz)  * sizeof (double));
+  rrlb = (double *) malloc ((1 + rrows) * sizeof (double));
+  rrub = (double *) malloc ((1 + rrows) * sizeof (double));
+
+  for (nClq = cnnz = rrows = rnnz = j = 0; j<nrows; j++) {
+
+    int end = (j==nrows-1) ? nnz : mbeg [j+1];
+
+    if (kind [j]) {
+
+      part [nClq]   = (kind [j] == 2);
+      cbeg [nClq++] = cnnz;
+
+      for (p = mbeg [j]; p < end; p++) {
+	cind [cnnz++] = mind [p];
+	++tbeg [mind [p] + 1];
+      }
+
+    } else {
+
+      rrlb [rrows]   = rlb [j];
+      rrub [rrows]   = rub [j];
+      rbeg [rrows++] = rnnz;
+
+      for (p = mbeg [j]; p < end; p++) {
+	rind [rnnz]   = mind [p];
+	rval [rnnz++] = mval [p];
+      }
+    }
+  }
+
+  cbeg [nClq] = cnnz;
+
+  for (i=0; i<ncols; i++)
+    tbeg [i+1] += tbeg [i];
+
+  memcpy (tpos, tbeg, ncols * sizeof (int));
+
+  for (j=0; j<nClq; j++)
+    for (p = cbeg [j]; p < cbeg [j+1]; p++)
+      trow [tpos [cind [p]]++] = j;
+
+  ++nCalls_;
+  nClique_  += nClq;
+  fullRows_ += fplpRows (nrows, rlb,  rub);
+  restRows_ += fplpRows (rrows, rrlb, rrub);
+  fullNz_   += fplpNumNz (nrows, nnz,  mbeg, rlb,  rub);
+  restNz_   += fplpNumNz (rrows, rnnz, rbeg, rrlb, rrub);
+
+  for (j=0; j<nClq; j++)
+    nPart_ += part [j];
+
+  fsol    = (double *) malloc ((1 + 2 * ncols) * sizeof (double));
+  queue   = (int    *) malloc ((1 + nClq)      * sizeof (int));
+  inQueue = (char   *) malloc ((1 + nClq)      * sizeof (char));
+
+  memcpy (sol,         lb, ncols * sizeof (double));
+  memcpy (sol + ncols, ub, ncols * sizeof (double));
+
+  for (i=0; i<ncols; i++)
+    chg [i] = 1;
+
+  // alternate the clique table, from the rows of the columns whose
+  // bounds changed (all at first), and the FPLP on the other rows
+
+  for (round = 0; round < CLIQUE_MAXROUNDS; round++) {
+
+    int n = 0, nChg;
+
+    double t = wallTime ();
+
+    memset (inQueue, 0, nClq * sizeof (char));
+
+    for (i=0; i<ncols; i++)
+      if (chg [i])
+	for (p = tbeg [i]; p < tbeg [i+1]; p++)
+	  if (!inQueue [trow [p]]) {
+	    inQueue [trow [p]] = 1;
+	    queue [n++] = trow [p];
+	  }
+
+    nChg = propagateCliques (nClq, cbeg, cind, part, tbeg, trow, sol, sol + ncols, queue, n, inQueue);
+
+    cliqueTime_ += wallTime () - t;
+
+    if (nChg < 0) {
+      valid = 0;
+      ++nInfeas_;
+      break;
+    }
+
+    if ((round && !nChg) || !rrows)
+      break;
+
+    // FPLP on the other rows
+
+    t = wallTime ();
+
+    valid = options -> reduce ?
+      reducedBounds  (env, options, ncols, rrows, rnnz, rbeg, rind, rval, rrlb, rrub, sol, sol + ncols, fsol) :
+      fixpointBounds (env, options, ncols, rrows, rnnz, rbeg, rind, rval, rrlb, rrub, sol, sol + ncols, fsol, &fplp);
+
+    if (fplp)
+      CPXfreeprob (env, &fplp);
+
+    fplpTime_ += wallTime () - t;
+
+    ++nRounds_;
+
+    if (!valid)
+      break;
+
+    for (nChg = i = 0; i<ncols; i++) {
+
+      chg [i] = 0;
+
+      if (fsol [i] > sol [i] + COUENNE_EPS * (1. + fabs (sol [i]))) {
+	sol [i] = fsol [i];
+	chg [i] = 1;
+      }
+
+      if (fsol [ncols + i] < sol [ncols + i] - COUENNE_EPS * (1. + fabs (sol [ncols + i]))) {
+	sol [ncols + i] = fsol [ncols + i];
+	chg [i] = 1;
+      }
+
+      nChg += chg [i];
+    }
+
+    if (!nChg)
+      break;
+  }
+
+  free (kind); free (chg);
+  free (cbeg); free (cind); free (part);
+  free (tbeg); free (tpos); free (trow);
+  free (rbeg); free (rind); free (rval);
+  free (rrlb); free (rrub);
+  free (fsol); free (queue); free (inQueue);
+
+  return valid;
+}
+
+/* print the statistics of the clique rows, and start them over */
+
+void cliqueStats () {
+
+  printf ("Clique rows: %d calls, %g rows/call to the clique table (%g partitioning), FPLP rows %g -> %g, FPLP nonzeros %g -> %g (%.1f%%), %g rounds/call, %d infeasible, clique time %g, FPLP time %g\n",
+	  nCalls_,
+	  nCalls_ ? (double) nClique_ / nCalls_ : 0.,
+	  nCalls_ ? (double) nPart_   / nCalls_ : 0.,
+	  nCalls_ ? fullRows_ / nCalls_ : 0., nCalls_ ? restRows_ / nCalls_ : 0.,
+	  fullNz_, restNz_,
+	  (fullNz_ > 0.) ? 100. * restNz_ / fullNz_ : 0.,
+	  nCalls_ ? (double) nRounds_ / nCalls_ : 0.,
+	  nInfeas_, cliqueTime_, fplpTime_);
+
+  nCalls_ = nClique_ = nPart_ = nRounds_ = nInfeas_ = 0;
+  fullRows_ = restRows_ = fullNz_ = restNz_ = cliqueTime_ = fplpTime_ = 0.;
+}
@@ -0,0 +1,223 @@
+/*
+ * Fix point FBBT as a cutting plane in Cplex -- coefficient tightening
+ *
+ * With the fixpoint bounds, the maximum activity of a row can be much
+ * smaller than with the original ones, and big-M rows can be
+ * strengthened. For a row a x <= b with maximum activity M > b, and an
+ * integer column x_k in [l, l+1], write x_k = l + y with y binary and
+ * the row as a_k y + rest <= b' = b - a_k l. If the rest alone can not
+ * violate the row when y is at its "loose" value, i.e.,
+ *
+ *   a_k > 0:  M_rest <  b'         then a_k -= d, b' -= d  (d = b' - M_rest)
+ *   a_k < 0:  M_rest + a_k < b'    then a_k  = b' - M_rest
+ *
+ * where M_rest is the maximum activity of the rest; the new row has the
+ * same integer points and a smaller LP relaxation. Rows a x >= b are
+ * negated; equality and ranged rows are left alone.
+ *
+ * This is done once at the root, where the fixpoint bounds are global,
+ * and each strengthened row is added as a cut that makes the original
+ * row redundant (Cplex does not let a callback change the model). The
+ * change in the root bound is measured on a copy of the root LP with
+ * the rows replaced.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "cplex.h"
+#include "cpxfbbt.h"
+
+#define COUENNE_EPS 1e-5
+#define COUENNE_INFINITY 1e50
+
+static int
+  nRows_  = 0, // rows strengthened
+  nCoefs_ = 0; // ... coefficients changed
+
+static double
+  objBefore_ = 0., // root LP bound before and after replacing the rows
+  objAfter_  = 0.;
+
+static char measured_ = 0;
+
+/* strengthen row (ind, val, nEl) <= b with the bounds [L,U] into
+   (nval, *nb). Returns the number of coefficients changed */
+
+static int tightenRow (int nEl, const int *ind, const double *val, double b,
+		       const char *ctype, const double *L, const double *U,
+		       double *nval, double *nb) {
+
+  int p, nChg = 0;
+
+  double maxAct = 0.;
+
+  for (p=0; p<nEl; p++) {
+
+    double bd = (val [p] > 0.) ? U [ind [p]] : L [ind [p]];
+
+    if (fabs (bd) >= CPX_INFBOUND)
+      return 0;
+
+    maxAct += val [p] * bd;
+    nval [p] = val [p];
+  }
+
+  *nb = b;
+
+  if (maxAct <= b + COUENNE_EPS) // redundant
+    return 0;
+
+  for (p=0; p<nEl; p++) {
+
+    int k = ind [p];
+
+    double
+      a = nval [p],
+      by, maxRest, a2;
+
+    if (((CPX_BINARY  != ctype [k]) &&
+	 (CPX_INTEGER != ctype [k])) ||
+	(fabs (U [k] - L [k] - 1.) > COUENNE_EPS) ||
+	(a == 0.))
+      continue;
+
+    by = *nb - a * L [k];
+
+    if (a > 0.) {
+
+      maxRest = maxAct - a * U [k];
+
+      if (maxRest >= by - COUENNE_EPS * (1. + fabs (a)))
+	continue;
+
+      a2  = a - (by - maxRest);
+      by  = maxRest;
+
+    } else {
+
+      maxRest = maxAct - a * L [k];
+
+      if (maxRest + a >= by - COUENNE_EPS * (1. + fabs (a)))
+	continue;
+
+      a2 = by - maxRest;
+    }
+
+    nval [p] = a2;
+    *nb      = by + a2 * L [k];
+    maxAct   = maxRest + a2 * ((a2 > 0.) ? U [k] : L [k]);
+
+    ++nChg;
+  }
+
+  return nChg;
+}
+
+/* strengthen the single-sided rows of the root LP with the fixpoint
+   bounds [L,U], add them as cuts and measure the root bound with the
+   rows replaced, within the work budget of the call (none if NULL).
+   Returns the number of rows added */
+
+int coefTighten (CPXCENVptr env,
+		 void *cbdata,
+		 int wherefrom,
+		 CPXLPptr nodeLP,
+		 int ncols,
+		 int nrows,
+		 int nnz,
+		 const int *mbeg,
+		 const int *mind,
+		 const double *mval,
+		 const double *rlb,
+		 const double *rub,
+		 const char *ctype,
+		 const double *L,
+		 const double *U,
+		 struct budget_s *work) {
+
+  int j, p, status, nAdded = 0;
+
+  double
+    *val  = (double *) malloc ((1 + ncols) * sizeof (double)),
+    *nval = (double *) malloc ((1 + ncols) * sizeof (double));
+
+  CPXLPptr copy = NULL;
+
+  for (j=0; j<nrows; j++) {
+
+    int
+      first = mbeg [j],
+      nEl   = ((j==nrows-1) ? nnz : mbeg [j+1]) - first,
+      nChg;
+
+    double
+      sign = (rub [j] < COUENNE_INFINITY) ? 1. : -1.,
+      nb;
+
+    if ((rlb [j] > -COUENNE_INFINITY) == (rub [j] < COUENNE_INFINITY)) // equality, ranged or free
+      continue;
+
+    for (p=0; p<nEl; p++)
+      val [p] = sign * mval [first + p];
+
+    if (!(nChg = tightenRow (nEl, mind + first, val, (sign > 0.) ? rub [j] : -rlb [j], ctype, L, U, nval, &nb)))
+      continue;
+
+    for (p=0; p<nEl; p++)
+      nval [p] *= sign;
+
+    nb *= sign;
+
+    if (CPXcutcallbackadd (env, cbdata, wherefrom, nEl, nb, (sign > 0.) ? 'L' : 'G', mind + first, nval, CPX_USECUT_FORCE))
+      break;
+
+    ++nAdded;
+    nCoefs_ += nChg;
+
+    if (!copy)
+      copy = CPXcloneprob (env, nodeLP, &status);
+
+    if (copy) {
+      for (p=0; p<nEl; p++)
+	CPXchgcoef (env, copy, j, mind [first + p], nval [p]);
+      CPXchgrhs (env, copy, 1, &j, &nb);
+    }
+  }
+
+  nRows_ += nAdded;
+
+  if (copy) {
+
+    if (!CPXgetcallbacknodeobjval (env, cbdata, wherefrom, &objBefore_) &&
+	!budgetLPopt (env, copy, work) &&
+	(CPXgetstat (env, copy) == CPX_STAT_OPTIMAL) &&
+	!CPXgetobjval (env, copy, &objAfter_))
+      measured_ = 1;
+
+    CPXfreeprob (env, &copy);
+  }
+
+  free (val);
+  free (nval);
+
+  return nAdded;
+}
+
+/* print the statistics of coefficient tightening, and start them over */
+
+void coefStats () {
+
+  printf ("Coefficient tightening: %d rows strengthened, %d coefficients", nRows_, nCoefs_);
+
+  if (measured_)
+    printf (", root bound %g -> %g", objBefore_, objAfter_);
+
+  printf ("\n");
+
+  nRows_ = nCoefs_ = 0;
+  objBefore_ = objAfter_ = 0.;
+  measured_ = 0;
+}
@@ -0,0 +1,294 @@
+/*
+ * Fix point FBBT as a cutting plane in Cplex -- solve daemon
+ *
+ * Solving many small models one process each pays process startup and
+ * CPXopenCPLEX every time. In daemon mode, jobs are read from a Unix
+ * socket: a client connects and sends one line with the command line
+ * of a job, i.e., options and model as for cpxfpfbbt (separated by
+ * blanks), for example
+ *
+ *   -f -q 5 model.lp
+ *
+ * The daemon keeps a pool of --jobs worker processes. Each worker is
+ * forked first, then opens its own Cplex environment and keeps it open:
+ * it takes a job, solves it in the worker process on that environment,
+ * sends its output (Cplex's log, and the Presolve: and Stats: lines) to
+ * the client as it is printed, closes the connection, and takes the
+ * next job. Between jobs, the environment gets default parameters and
+ * no callbacks, and the separator modules start their statistics over
+ * when they print them at the end of a job. Jobs are solved by the
+ * caller's main, so that a job's options behave as on the command line
+ * (except --daemon, --race and --configs, which are ignored).
+ *
+ * An environment is never shared between processes, as Cplex does not
+ * support that. A job that fails (exits) or whose client goes away
+ * while it runs takes its worker with it, and the daemon forks a new
+ * one. SIGINT or SIGTERM stop the daemon: idle workers exit, running
+ * jobs are completed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "cplex.h"
+#include "cpxfbbt.h"
+
+#define DAEMON_LINE    4096
+#define DAEMON_MAXARGS 256
+#define DAEMON_BACKLOG 64
+
+static volatile sig_atomic_t stop_ = 0;
+
+static void daemonStop (int sig) {
+
+  stop_ = 1;
+}
+
+/* read a line (without the newline) from fd into line. Returns its
+   length, -1 if nothing could be read */
+
+static int readLine (int fd, char *line, int size) {
+
+  int n = 0;
+
+  char c;
+
+  while ((n < size - 1) && (read (fd, &c, 1) == 1) && (c != '\n'))
+    if (c != '\r')
+      line [n++] = c;
+
+  line [n] = 0;
+
+  return n ? n : -1;
+}
+
+/* split line into an argv for readargs, with progName first */
+
+static char **splitArgs (char *line, char *progName, int *argc) {
+
+  char
+    **argv = (char **) malloc (DAEMON_MAXARGS * sizeof (char *)),
+    *tok   = strtok (line, " \t");
+
+  *argc = 0;
+  argv [(*argc)++] = progName;
+
+  while (tok && (*argc < DAEMON_MAXARGS - 1)) {
+    argv [(*argc)++] = tok;
+    tok = strtok (NULL, " \t");
+  }
+
+  argv [*argc] = NULL;
+
+  return argv;
+}
+
+/* worker: open Cplex, then solve jobs from fd one after another with
+   solve, on the same environment, with the output going to the
+   client. Does not return */
+
+static void daemonWorker (int fd,
+			  char *progName,
+			  int (*solve) (CPXENVptr env, int argc, char **argv)) {
+
+  int status, conn, argc,
+    out = dup (STDOUT_FILENO),
+    err = dup (STDERR_FILENO);
+
+  char
+    **argv,
+    *line = (char *) malloc (DAEMON_LINE * sizeof (char));
+
+  sigset_t term;
+
+  CPXENVptr env;
+
+  // idle, die on the daemon's SIGTERM; Ctrl-C is for the daemon only
+
+  signal (SIGTERM, SIG_DFL);
+  signal (SIGINT,  SIG_IGN);
+  signal (SIGCHLD, SIG_DFL);
+
+  sigemptyset (&term);
+  sigaddset   (&term, SIGTERM);
+
+  if (!(env = CPXopenCPLEX (&status))) {
+    printf ("Daemon: worker %d could not open Cplex, error code %d\n", (int) getpid (), status);
+    exit (-1);
+  }
+
+  setvbuf (stdout, NULL, _IOLBF, 0); // stream the output line by line
+
+  while (1) {
+
+    while (((conn = accept (fd, NULL, NULL)) < 0) && (errno == EINTR));
+
+    if (conn < 0)
+      break;
+
+    sigprocmask (SIG_BLOCK, &term, NULL); // busy: finish the job
+
+    if (readLine (conn, line, DAEMON_LINE) >= 0) {
+
+      fflush (stdout);
+      fflush (stderr);
+
+      dup2 (conn, STDOUT_FILENO);
+      dup2 (conn, STDERR_FILENO);
+
+      argv = splitArgs (line, progName, &argc);
+
+      solve (env, argc, argv);
+
+      free (argv);
+
+      fflush (stdout);
+      fflush (stderr);
+
+      dup2 (out, STDOUT_FILENO);
+      dup2 (err, STDERR_FILENO);
+    }
+
+    close (conn);
+
+    // the next job starts from default parameters and no callbacks
+
+    CPXsetdefaults (env);
+
+    CPXsetusercutcallbackfunc    (env, NULL, NULL);
+    CPXsetbranchcallbackfunc     (env, NULL, NULL);
+    CPXsetdeletenodecallbackfunc (env, NULL, NULL);
+    CPXsetheuristiccallbackfunc  (env, NULL, NULL);
+    CPXsetlpcallbackfunc         (env, NULL, NULL);
+
+    sigprocmask (SIG_UNBLOCK, &term, NULL); // stop here if the daemon did
+  }
+
+  CPXcloseCPLEX (&env);
+  exit (-1);
+}
+
+/* serve jobs from the Unix socket sockPath with a pool of maxJobs
+   workers, each solving its jobs with solve. Returns in the daemon
+   once stopped; workers do not return */
+
+int daemonRun (const char *sockPath,
+	       int maxJobs,
+	       char *progName,
+	       int (*solve) (CPXENVptr env, int argc, char **argv)) {
+
+  struct sockaddr_un addr;
+  struct sigaction sa;
+
+  int
+    k, fd,
+    nAlive = 0,
+    nForks = 0;
+
+  pid_t pid, *pids;
+
+  if (maxJobs < 1)
+    maxJobs = 1;
+
+  if (strlen (sockPath) >= sizeof (addr. sun_path)) {
+    printf ("Daemon: socket path %s too long\n", sockPath);
+    exit (-1);
+  }
+
+  memset (&addr, 0, sizeof (addr));
+  addr. sun_family = AF_UNIX;
+  strcpy (addr. sun_path, sockPath);
+
+  unlink (sockPath);
+
+  if (((fd = socket (AF_UNIX, SOCK_STREAM, 0)) < 0) ||
+      bind   (fd, (struct sockaddr *) &addr, sizeof (addr)) ||
+      listen (fd, DAEMON_BACKLOG)) {
+    printf ("Daemon: could not listen on %s\n", sockPath);
+    exit (-1);
+  }
+
+  // no SA_RESTART: a signal interrupts wait
+
+  memset (&sa, 0, sizeof (sa));
+  sa. sa_handler = daemonStop;
+  sigaction (SIGINT,  &sa, NULL);
+  sigaction (SIGTERM, &sa, NULL);
+
+  pids = (pid_t *) calloc (maxJobs, sizeof (pid_t));
+
+  printf ("Daemon: listening on %s, %d workers\n", sockPath, maxJobs);
+
+  while (!stop_) {
+
+    // fork a worker into each free slot
+
+    for (k=0; (k < maxJobs) && !stop_; k++)
+
+      if (!pids [k]) {
+
+	fflush (stdout);
+
+	if ((pid = fork ()) < 0) {
+	  printf ("Daemon: could not fork worker\n");
+	  break;
+	}
+
+	if (!pid) {
+	  free (pids);
+	  daemonWorker (fd, progName, solve);
+	}
+
+	pids [k] = pid;
+	++nAlive;
+	++nForks;
+      }
+
+    fflush (stdout);
+
+    // a worker has exited, as a job failed (or the client went away
+    // while it was running): replace it
+
+    if ((pid = wait (NULL)) > 0)
+
+      for (k=0; k<maxJobs; k++)
+	if (pids [k] == pid) {
+	  pids [k] = 0;
+	  --nAlive;
+	}
+  }
+
+  // stopped: idle workers exit, busy ones finish their job
+
+  printf ("Daemon: stopping, %d workers left\n", nAlive);
+
+  close  (fd);
+  unlink (sockPath);
+
+  for (k=0; k<maxJobs; k++)
+    if (pids [k])
+      kill (pids [k], SIGTERM);
+
+  while (nAlive) {
+
+    if ((pid = wait (NULL)) > 0)
+      --nAlive;
+    else if (errno != EINTR)
+      break;
+  }
+
+  printf ("Daemon: %d workers forked\n", nForks);
+
+  free (pids);
+
+  return -1;
+}
@@ -0,0 +1,379 @@
+/*
+ * Fix point FBBT -- daemon latency benchmark
+ *
+ * Each model is solved --reps times in two ways: running the solver
+ * binary as a new process, and sending the same job to a daemon
+ * (cpxfpfbbt --daemon) on --socket. Latency is the wall-clock time
+ * from start to the end of the job's output. One line per run:
+ *
+ * daemonbench: model,rep,process,daemon
+ *
+ * followed by the Stats: line streamed back by the daemon, and a
+ * summary with the mean latencies. Start the daemon with --jobs 1 for
+ * a fair comparison of single jobs.
+ *
+ * A single job finds an idle daemon worker with Cplex already open,
+ * the daemon's best case. With --queued N, throughput is measured as
+ * well: N jobs (cycling through the models) are run as processes, at
+ * most --parallel at a time, and then sent to the daemon, keeping up
+ * to BENCH_INFLIGHT of them queued on its socket. Start the daemon
+ * with --jobs equal to --parallel for this.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "cmdline.h"
+
+#define BENCH_LINE    4096
+#define BENCH_MAXARGS 256
+#define BENCH_INFLIGHT 32
+
+static double wallTime () {
+
+  struct timeval tv;
+  gettimeofday (&tv, NULL);
+  return (double) tv. tv_sec + (double) tv. tv_usec / 1e6;
+}
+
+/* read the output of a job from fd until it is closed, keeping its
+   stats line in stats (empty if there is none) */
+
+static void readStats (int fd, char *stats) {
+
+  char line [BENCH_LINE];
+
+  FILE *f = fdopen (fd, "r");
+
+  *stats = 0;
+
+  if (!f) {
+    close (fd);
+    return;
+  }
+
+  while (fgets (line, BENCH_LINE, f))
+    if (!strncmp (line, "Stats:", 6))
+      strcpy (stats, line);
+
+  fclose (f);
+}
+
+/* start binary with options on model as a new process, with its
+   output to outFd. Returns its pid, -1 on error */
+
+static pid_t startProcess (const char *binary, const char *jobOpt, const char *model, int outFd) {
+
+  int argc = 0;
+
+  char
+    *opts = strdup (jobOpt),
+    *argv [BENCH_MAXARGS],
+    *tok;
+
+  pid_t pid;
+
+  argv [argc++] = (char *) binary;
+
+  for (tok = strtok (opts, " \t"); tok && (argc < BENCH_MAXARGS - 2); tok = strtok (NULL, " \t"))
+    argv [argc++] = tok;
+
+  argv [argc++] = (char *) model;
+  argv [argc]   = NULL;
+
+  fflush (stdout);
+
+  if (!(pid = fork ())) {
+    dup2 (outFd, STDOUT_FILENO);
+    execvp (binary, argv);
+    _exit (-1);
+  }
+
+  free (opts);
+
+  return pid;
+}
+
+/* run binary with options on model as a new process. Returns the
+   latency, -1 on error */
+
+static double runProcess (const char *binary, const char *jobOpt, const char *model, char *stats) {
+
+  int pfd [2];
+
+  double time0 = wallTime ();
+
+  pid_t pid;
+
+  if (pipe (pfd))
+    return -1.;
+
+  fcntl (pfd [0], F_SETFD, FD_CLOEXEC);
+  fcntl (pfd [1], F_SETFD, FD_CLOEXEC);
+
+  pid = startProcess (binary, jobOpt, model, pfd [1]);
+
+  close (pfd [1]);
+
+  if (pid < 0) {
+    close (pfd [0]);
+    return -1.;
+  }
+
+  readStats (pfd [0], stats);
+  waitpid (pid, NULL, 0);
+
+  return wallTime () - time0;
+}
+
+/* connect to the daemon on sockPath and send it a job. Returns the
+   connection, -1 on error */
+
+static int sendJob (const char *sockPath, const char *jobOpt, const char *model) {
+
+  struct sockaddr_un addr;
+
+  char line [BENCH_LINE];
+
+  int fd = socket (AF_UNIX, SOCK_STREAM, 0);
+
+  memset (&addr, 0, sizeof (addr));
+  addr. sun_family = AF_UNIX;
+  strncpy (addr. sun_path, sockPath, sizeof (addr. sun_path) - 1);
+
+  if ((fd < 0) || connect (fd, (struct sockaddr *) &addr, sizeof (addr))) {
+    if (fd >= 0)
+      close (fd);
+    return -1;
+  }
+
+  fcntl (fd, F_SETFD, FD_CLOEXEC);
+
+  snprintf (line, BENCH_LINE, "%s %s\n", jobOpt, model);
+
+  if (write (fd, line, strlen (line)) != (ssize_t) strlen (line)) {
+    close (fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+/* send the same job to the daemon on sockPath. Returns the latency,
+   -1 on error */
+
+static double runDaemon (const char *sockPath, const char *jobOpt, const char *model, char *stats) {
+
+  double time0 = wallTime ();
+
+  int fd = sendJob (sockPath, jobOpt, model);
+
+  if (fd < 0)
+    return -1.;
+
+  readStats (fd, stats);
+
+  return wallTime () - time0;
+}
+
+/* run n jobs, cycling through models, as processes, at most nPar at a
+   time. Returns the time taken, -1 on error */
+
+static double batchProcess (const char *binary, const char *jobOpt, char **models, int nModels, int n, int nPar) {
+
+  int
+    started = 0,
+    running = 0,
+    null    = open ("/dev/null", O_WRONLY | O_CLOEXEC);
+
+  double time0 = wallTime ();
+
+  if (null < 0)
+    return -1.;
+
+  while ((started < n) || running)
+
+    if ((started < n) && (running < nPar)) {
+
+      if (startProcess (binary, jobOpt, models [started % nModels], null) < 0)
+	break;
+
+      ++started;
+      ++running;
+
+    } else if (wait (NULL) > 0)
+      --running;
+    else break;
+
+  while (running && (wait (NULL) > 0))
+    --running;
+
+  close (null);
+
+  return (started < n) ? -1. : wallTime () - time0;
+}
+
+/* send n jobs, cycling through models, to the daemon on sockPath,
+   keeping up to BENCH_INFLIGHT of them queued, and read their output.
+   Returns the time taken, -1 on error */
+
+static double batchDaemon (const char *sockPath, const char *jobOpt, char **models, int nModels, int n) {
+
+  struct pollfd conn [BENCH_INFLIGHT];
+
+  char buf [BENCH_LINE];
+
+  int
+    k,
+    sent  = 0,
+    done  = 0,
+    nOpen = 0;
+
+  double time0 = wallTime ();
+
+  while (done < n) {
+
+    // keep the daemon's queue full
+
+    while ((sent < n) && (nOpen < BENCH_INFLIGHT)) {
+
+      if ((conn [nOpen]. fd = sendJob (sockPath, jobOpt, models [sent % nModels])) < 0)
+	break;
+
+      conn [nOpen++]. events = POLLIN;
+      ++sent;
+    }
+
+    if (!nOpen || (poll (conn, nOpen, -1) < 0))
+      break;
+
+    // a job is done when the daemon closes its connection
+
+    for (k=0; k<nOpen;)
+
+      if (conn [k]. revents && (read (conn [k]. fd, buf, BENCH_LINE) <= 0)) {
+	close (conn [k]. fd);
+	conn [k] = conn [--nOpen];
+	++done;
+      } else ++k;
+  }
+
+  for (k=0; k<nOpen; k++)
+    close (conn [k]. fd);
+
+  return (done < n) ? -1. : wallTime () - time0;
+}
+
+int main (int argc, char **argv) {
+
+  int i, r, nReps, nQueued, nPar, nModels, nRuns = 0;
+
+  char
+    ifHelp   = 0,
+    **filenames,
+    *sockPath = (char *) malloc (sizeof (char)),
+    *binary   = (char *) malloc (sizeof (char)),
+    *jobOpt   = (char *) malloc (sizeof (char)),
+    stats [BENCH_LINE];
+
+  double totProc = 0., totDaemon = 0.;
+
+  tpar options [] = {{ 'L',  CSTR() "socket",  0, &sockPath, TSTRING, CSTR() "Unix socket of the daemon"}
+		     ,{'b',  CSTR() "binary",  0, &binary,   TSTRING, CSTR() "Solver binary run as one process per model (default: cpxfpfbbt)"}
+		     ,{'o',  CSTR() "options", 0, &jobOpt,   TSTRING, CSTR() "Options of every job, quoted (default: none)"}
+		     ,{'n',  CSTR() "reps",    1, &nReps,    TINT,    CSTR() "Runs of each model in each mode (default: 1)"}
+		     ,{'N',  CSTR() "queued",  0, &nQueued,  TINT,    CSTR() "Also run a batch of this many jobs in each mode, for throughput (default: 0, none)"}
+		     ,{'P',  CSTR() "parallel", 1, &nPar,    TINT,    CSTR() "Batch: processes at a time, as the daemon's --jobs (default: 1)"}
+		     ,{'h',  CSTR() "help",    0, &ifHelp,   TTOGGLE, CSTR() "Print this help and exit"}
+		     ,{0,    CSTR() "",        0, NULL,      TTOGGLE, CSTR() ""} // THIS ENTRY ALWAYS AT THE END
+  };
+
+  set_default_args (options);
+
+  filenames = readargs (argc, argv, options);
+
+  if (ifHelp || !filenames || !*sockPath) {
+
+    print_help (argv [0], options);
+
+    if (!ifHelp)
+      printf ("Need a socket and at least one model, exiting\n");
+
+    return 0;
+  }
+
+  if (!*binary) {
+    binary = (char *) realloc (binary, (1 + strlen ("cpxfpfbbt")) * sizeof (char));
+    strcpy (binary, "cpxfpfbbt");
+  }
+
+  for (i=0; filenames [i]; ++i)
+
+    for (r=0; r<nReps; r++) {
+
+      double
+	tProc   = runProcess (binary,   jobOpt, filenames [i], stats),
+	tDaemon = runDaemon  (sockPath, jobOpt, filenames [i], stats);
+
+      printf ("daemonbench: %s,%d,%g,%g\n", filenames [i], r, tProc, tDaemon);
+
+      if (*stats)
+	printf ("Job %s: %s", filenames [i], stats);
+
+      if ((tProc < 0.) || (tDaemon < 0.)) {
+	printf ("daemonbench: %s failed\n", (tProc < 0.) ? binary : sockPath);
+	continue;
+      }
+
+      totProc   += tProc;
+      totDaemon += tDaemon;
+      ++nRuns;
+    }
+
+  printf ("Daemon bench: %d runs, mean latency %g s one process per model, %g s through the daemon (%.1f%%)\n",
+	  nRuns,
+	  nRuns ? totProc   / nRuns : 0.,
+	  nRuns ? totDaemon / nRuns : 0.,
+	  (totProc > 0.) ? 100. * totDaemon / totProc : 0.);
+
+  // throughput of a batch of queued jobs
+
+  for (nModels = 0; filenames [nModels]; ++nModels);
+
+  if (nPar < 1)
+    nPar = 1;
+
+  if (nQueued > 0) {
+
+    double
+      tProc   = batchProcess (binary,   jobOpt, filenames, nModels, nQueued, nPar),
+      tDaemon = batchDaemon  (sockPath, jobOpt, filenames, nModels, nQueued);
+
+    printf ("Daemon bench: batch of %d jobs, %g s as processes (%d at a time, %g jobs/s), %g s through the daemon (%g jobs/s)\n",
+	    nQueued,
+	    tProc, nPar,
+	    (tProc   > 0.) ? nQueued / tProc   : 0.,
+	    tDaemon,
+	    (tDaemon > 0.) ? nQueued / tDaemon : 0.);
+  }
+
+  for (i=0; filenames [i]; ++i)
+    free (filenames [i]);
+
+  free (filenames);
+  free (sockPath);
+  free (binary);
+  free (jobOpt);
+
+  return 0;
+}
@@ -0,0 +1,423 @@
+/*
+ * Fix point FBBT as a cutting plane in Cplex -- difference rows
+ *
+ * Rows a x_i - a x_j in [l,u] (precedences, time windows) give
+ * constraints x_i - x_j <= c, and propagating them to a fixpoint is a
+ * shortest path problem: U_i <= U_j + c is an arc j -> i of length c on
+ * the upper bounds, and -L_j <= -L_i + c an arc i -> j of length c on
+ * the (negated) lower bounds. Upper and lower bounds are independent,
+ * and each is closed with a queue-based Bellman-Ford from the columns
+ * whose bound changed. A column queued n times (not relaxed: a column
+ * with many predecessors is relaxed many times per pass) lies on a
+ * negative cycle, and the rows are infeasible; cycles through columns
+ * with infinite bounds are found once per call with paths from a
+ * virtual source. Single-element rows are plain bounds, applied once.
+ *
+ * The other rows go to the FPLP as usual. The graph and the FPLP are
+ * alternated, each starting from the bounds of the other, until neither
+ * tightens anything: as for the chunks of cpxfbbt_chunk.c, the result
+ * is the fixpoint of all rows, i.e., the bounds of the full FPLP.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <sys/time.h>
+
+#include "cplex.h"
+#include "cpxfbbt.h"
+
+#define COUENNE_EPS 1e-5
+#define COUENNE_INFINITY 1e50
+
+#define DIFF_MAXROUNDS 50
+
+static int
+  nCalls_   = 0,
+  nGraphR_  = 0, // rows handled by the graph
+  nFPLPR_   = 0, // ... and by the FPLP
+  nRounds_  = 0, // graph/FPLP alternations
+  nCycles_  = 0; // negative cycles (or crossing bounds) found
+
+static double
+  graphTime_ = 0.,
+  fplpTime_  = 0.;
+
+static double wallTime () {
+
+  struct timeval tv;
+  gettimeofday (&tv, NULL);
+  return (double) tv. tv_sec + (double) tv. tv_usec / 1e6;
+}
+
+/* propagate the decrease of the values val of the columns in queue
+   (n of them, marked in inQueue) along the arcs (beg, head, len).
+   Returns the number of values changed, -1 if a value crossed its
+   opposite bound (-opp) or a column was queued ncols times */
+
+static int shortestPaths (int ncols,
+			  const int *beg,
+			  const int *head,
+			  const double *len,
+			  double *val,
+			  const double *opp,
+			  int *queue,
+			  int n,
+			  char *inQueue,
+			  int *count) {
+
+  int
+    qHead = 0,
+    nChg  = 0;
+
+  memset (count, 0, ncols * sizeof (int));
+
+  while (n) {
+
+    int p, j = queue [qHead];
+
+    qHead = (qHead + 1) % ncols;
+    --n;
+    inQueue [j] = 0;
+
+    if (val [j] >= CPX_INFBOUND)
+      continue;
+
+    for (p = beg [j]; p < beg [j+1]; p++) {
+
+      int i = head [p];
+
+      double cand = val [j] + len [p];
+
+      if (cand >= val [i] - COUENNE_EPS * (1. + fabs (val [i])))
+	continue;
+
+      val [i] = cand;
+      ++nChg;
+
+      if (cand < -opp [i] - COUENNE_EPS * (1. + fabs (cand)))
+	return -1;
+
+      if (!inQueue [i]) {
+
+	if (++count [i] >= ncols) // queued once per pass, at most ncols-1 passes without a cycle
+	  return -1;
+
+	inQueue [i] = 1;
+	queue [(qHead + n++) % ncols] = i;
+      }
+    }
+  }
+
+  return nChg;
+}
+
+/* fixpoint bounds of the given rows and column bounds into sol (xL,
+   then xU), with the single-element and difference rows handled by a
+   shortest path closure and the others by the FPLP. Returns true if
+   the bounds in sol are valid, false if not (or if infeasible), and -1
+   if there are no such rows */
+
+int diffFixpoint (CPXCENVptr env,
+		  struct option_s *options,
+		  int ncols,
+		  int nrows,
+		  int nnz,
+		  const int *mbeg,
+		  const int *mind,
+		  const double *mval,
+		  const double *rlb,
+		  const double *rub,
+		  const double *lb,
+		  const double *ub,
+		  double *sol) {
+
+  int
+    i, j, k, p, round,
+    nDiff = 0,
+    rrows = 0, rnnz = 0,
+    valid = 1,
+    *uBeg, *uHead, *uPos, *lBeg, *lHead, *lPos, *rbeg, *rind,
+    *queue, *count;
+
+  double
+    *uLen, *lLen, *rval, *rrlb, *rrub, *negL, *fsol;
+
+  char
+    *kind = (char *) malloc ((1 + nrows) * sizeof (char)), // 0: FPLP, 1: single element, 2: difference
+    *chg  = (char *) malloc ((1 + ncols) * sizeof (char)), // bound changed by the FPLP (1: lower, 2: upper)
+    *inQueue;
+
+  // classify rows
+
+  for (j=0; j<nrows; j++) {
+
+    int
+      first = mbeg [j],
+      nEl   = ((j==nrows-1) ? nnz : mbeg [j+1]) - first;
+
+    if ((nEl == 1) && (mval [first] != 0.))
+      kind [j] = 1;
+
+    else if ((nEl == 2) &&
+	     (mval [first] != 0.) &&
+	     (fabs (mval [first] + mval [first + 1]) <= COUENNE_EPS * fabs (mval [first]))) {
+      kind [j] = 2;
+      ++nDiff;
+
+    } else {
+      kind [j] = 0;
+      ++rrows;
+      rnnz += nEl;
+    }
+  }
+
+  if (!nDiff) { // nothing for the graph, leave it all to the FPLP
+    free (kind);
+    free (chg);
+    return -1;
+  }
+
+  ++nCalls_;
+  nGraphR_ += nrows - rrows;
+  nFPLPR_  += rrows;
+
+  // arcs, one per finite side: for x_f - x_t <= c, t -> f on U and
+  // f -> t on -L. Count them, then fill
+
+  uBeg  = (int    *) calloc ((ncols + 2), sizeof (int));
+  lBeg  = (int    *) calloc ((ncols + 2), sizeof (int));
+  uPos  = (int    *) malloc ((1 + ncols)     * sizeof (int));
+  lPos  = (int    *) malloc ((1 + ncols)     * sizeof (int));
+  uHead = (int    *) malloc ((1 + 2 * nDiff) * sizeof (int));
+  lHead = (int    *) malloc ((1 + 2 * nDiff) * sizeof (int));
+  uLen  = (double *) malloc ((1 + 2 * nDiff) * sizeof (double));
+  lLen  = (double *) malloc ((1 + 2 * nDiff) * sizeof (double));
+
+  for (p=0; p<2; p++) {
+
+    if (p) {
+
+      for (i=0; i<ncols; i++) {
+	uBeg [i+1] += uBeg [i];
+	lBeg [i+1] += lBeg [i];
+      }
+
+      memcpy (uPos, uBeg, ncols * sizeof (int));
+      memcpy (lPos, lBeg, ncols * sizeof (int));
+    }
+
+    for (j=0; j<nrows; j++)
+      if (kind [j] == 2) {
+
+	int
+	  first = mbeg [j],
+	  xi    = mind [first],
+	  xj    = mind [first + 1],
+	  from [2], to [2];
+
+	double
+	  a = mval [first],
+	  c [2];
+
+	if (a < 0.) { // a (x_i - x_j) = |a| (x_j - x_i)
+	  a  = -a;
+	  xi = mind [first + 1];
+	  xj = mind [first];
+	}
+
+	// x_i - x_j <= rub/a and x_j - x_i <= -rlb/a
+
+	from [0] = xi; to [0] = xj; c [0] = (rub [j] <  COUENNE_INFINITY) ?  rub [j] / a : COUENNE_INFINITY;
+	from [1] = xj; to [1] = xi; c [1] = (rlb [j] > -COUENNE_INFINITY) ? -rlb [j] / a : COUENNE_INFINITY;
+
+	for (k=0; k<2; k++)
+	  if (c [k] < COUENNE_INFINITY) {
+
+	    if (!p) {
+	      ++uBeg [to   [k] + 1];
+	      ++lBeg [from [k] + 1];
+	    } else {
+	      uHead [uPos [to [k]]]     = from [k];
+	      uLen  [uPos [to [k]]++]   = c [k];
+	      lHead [lPos [from [k]]]   = to [k];
+	      lLen  [lPos [from [k]]++] = c [k];
+	    }
+	  }
+      }
+  }
+
+  // FPLP rows
+
+  rbeg = (int    *) malloc ((1 + rrows) * sizeof (int));
+  rind = (int    *) malloc ((1 + rnnz)  * sizeof (int));
+  rval = (double *) malloc ((1 + rnnz)  * sizeof (double));
+  rrlb = (double *) malloc ((1 + rrows) * sizeof (double));
+  rrub = (double *) malloc ((1 + rrows) * sizeof (double));
+
+  for (rrows = rnnz = j = 0; j<nrows; j++)
+    if (!kind [j]) {
+
+      rrlb [rrows]   = rlb [j];
+      rrub [rrows]   = rub [j];
+      rbeg [rrows++] = rnnz;
+
+      for (p = mbeg [j]; p < ((j==nrows-1) ? nnz : mbeg [j+1]); p++) {
+	rind [rnnz]   = mind [p];
+	rval [rnnz++] = mval [p];
+      }
+    }
+
+  // initial bounds, with the single-element rows
+
+  negL    = (double *) malloc ((1 + ncols)     * sizeof (double));
+  fsol    = (double *) malloc ((1 + 2 * ncols) * sizeof (double));
+  queue   = (int    *) malloc ((1 + ncols)     * sizeof (int));
+  count   = (int    *) malloc ((1 + ncols)     * sizeof (int));
+  inQueue = (char   *) malloc ((1 + ncols)     * sizeof (char));
+
+  // negative cycles, even through columns with infinite bounds: paths
+  // from a source at distance zero from every column
+
+  for (i=0; i<ncols; i++) {
+    fsol  [i]         = 0.;
+    fsol  [ncols + i] = COUENNE_INFINITY;
+    queue [i]         = i;
+    inQueue [i]       = 1;
+  }
+
+  if (shortestPaths (ncols, uBeg, uHead, uLen, fsol, fsol + ncols, queue, ncols, inQueue, count) < 0) {
+    valid = 0;
+    ++nCycles_;
+  }
+
+  memcpy (sol,         lb, ncols * sizeof (double));
+  memcpy (sol + ncols, ub, ncols * sizeof (double));
+
+  for (j=0; j<nrows; j++)
+    if (kind [j] == 1) {
+
+      double
+	a = mval [mbeg [j]],
+	lo = (a > 0.) ? rlb [j] : rub [j], // a x in [l,u], i.e., x in [lo/a, up/a]
+	up = (a > 0.) ? rub [j] : rlb [j];
+
+      i = mind [mbeg [j]];
+
+      if ((lo > -COUENNE_INFINITY) && (lo < COUENNE_INFINITY) && (lo / a > sol [i]))         sol [i]         = lo / a;
+      if ((up > -COUENNE_INFINITY) && (up < COUENNE_INFINITY) && (up / a < sol [ncols + i])) sol [ncols + i] = up / a;
+
+      if (sol [i] > sol [ncols + i] + COUENNE_EPS * (1. + fabs (sol [i]))) {
+	valid = 0;
+	++nCycles_;
+      }
+    }
+
+  for (i=0; i<ncols; i++) {
+    negL [i] = -sol [i];
+    chg  [i] = 3;
+  }
+
+  // alternate the graph, from the columns whose bounds changed (all
+  // at first), and the FPLP on the other rows
+
+  for (round = 0; round < DIFF_MAXROUNDS; round++) {
+
+    int n, nChg = 0;
+
+    double t = wallTime ();
+
+    for (k=0; (k<2) && valid; k++) { // upper bounds, then lower bounds
+
+      for (n=i=0; i<ncols; i++)
+	if ((inQueue [i] = ((chg [i] & (k ? 1 : 2)) != 0)))
+	  queue [n++] = i;
+
+      if (k) n = shortestPaths (ncols, lBeg, lHead, lLen, negL,        sol + ncols, queue, n, inQueue, count);
+      else   n = shortestPaths (ncols, uBeg, uHead, uLen, sol + ncols, negL,        queue, n, inQueue, count);
+
+      if (n < 0) {
+	valid = 0;
+	++nCycles_;
+      }
+
+      nChg += n;
+    }
+
+    for (i=0; i<ncols; i++)
+      sol [i] = -negL [i];
+
+    graphTime_ += wallTime () - t;
+
+    if (!valid || (round && !nChg) || !rrows)
+      break;
+
+    // FPLP on the other rows
+
+    {
+      CPXLPptr fplp = NULL;
+
+      t = wallTime ();
+
+      valid = fixpointBounds (env, options, ncols, rrows, rnnz, rbeg, rind, rval, rrlb, rrub, sol, sol + ncols, fsol, &fplp);
+
+      if (fplp)
+	CPXfreeprob (env, &fplp);
+
+      fplpTime_ += wallTime () - t;
+    }
+
+    ++nRounds_;
+
+    if (!valid)
+      break;
+
+    for (nChg = i = 0; i<ncols; i++) {
+
+      chg [i] = 0;
+
+      if (fsol [i] > sol [i] + COUENNE_EPS * (1. + fabs (sol [i]))) {
+	sol  [i] = fsol [i];
+	negL [i] = -fsol [i];
+	chg  [i] |= 1;
+	++nChg;
+      }
+
+      if (fsol [ncols + i] < sol [ncols + i] - COUENNE_EPS * (1. + fabs (sol [ncols + i]))) {
+	sol [ncols + i] = fsol [ncols + i];
+	chg [i] |= 2;
+	++nChg;
+      }
+    }
+
+    if (!nChg)
+      break;
+  }
+
+  free (kind); free (chg);
+  free (uBeg); free (uPos); free (uHead); free (uLen);
+  free (lBeg); free (lPos); free (lHead); free (lLen);
+  free (rbeg); free (rind); free (rval);
+  free (rrlb); free (rrub);
+  free (negL); free (fsol);
+  free (queue); free (count); free (inQueue);
+
+  return valid;
+}
+
+/* print the statistics of the difference rows, and start them over */
+
+void diffStats () {
+
+  printf ("Difference rows: %d calls, %g rows/call to the graph, %g to the FPLP, %g rounds/call, %d infeasible, graph time %g, FPLP time %g\n",
+	  nCalls_,
+	  nCalls_ ? (double) nGraphR_ / nCalls_ : 0.,
+	  nCalls_ ? (double) nFPLPR_  / nCalls_ : 0.,
+	  nCalls_ ? (double) nRounds_ / nCalls_ : 0.,
+	  nCycles_, graphTime_, fplpTime_);
+
+  nCalls_ = nGraphR_ = nFPLPR_ = nRounds_ = nCycles_ = 0;
+  graphTime_ = fplpTime_ = 0.;
+}
@@ -0,0 +1,433 @@
+/*
+ * Fix point FBBT as a cutting plane in Cplex -- FPLP construction
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+
+#include <sys/time.h>
+
+#include "cplex.h"
+#include "cpxfbbt.h"
+
+//#define DEBUG
+
+#define COUENNE_EPS 1e-5
+#define DBL_MAX 1e50
+#define COUENNE_INFINITY 1e50
+
+/* build the fixpoint LP of the rows (mbeg, mind, mval) with row bounds
+   [rlb, rub] and column bounds [lb, ub]. Columns 0..ncols-1 are xL,
+   ncols..2*ncols-1 are xU, and the objective sense is already set.
+
+   Rows are added one at a time, so only their number can overflow an
+   int, not the FPLP's nonzeros. Returns NULL if the FPLP has more rows
+   than Cplex allows */
+
+CPXLPptr createFPLP (CPXCENVptr env,
+		     int ncols,
+		     int nrows,
+		     int nnz,
+		     const int *mbeg,
+		     const int *mind,
+		     const double *mval,
+		     const double *rlb,
+		     const double *rub,
+		     const double *lb,
+		     const double *ub,
+		     char extendedModel_) {
+
+  CPXLPptr fplp;
+
+  const int    *ind;
+  const double *coe;
+
+  int status, i, j;
+
+  /******************************************************************
+
+    An LP relaxation of a MINLP problem is available. Let us suppose
+    that this LP relaxation is of the form
+
+    LP = {x in R^n: Ax <= b}
+ 
+    for suitable nxm matrix A, rhs vector b, and variable vector
+    x. Our purpose is that of creating a much larger LP that will
+    help us find the interval [l,u] corresponding to the fixpoint of
+    an FBBT algorithm. To this purpose, consider a single constraint
+    of the above system:
+
+    sum {i=1..n} a_ji x_i <= b_j
+
+    According to two schools of thought (Leo's and mine), this
+    single constraint can give rise to a number of FBBT
+    constraints. The two schools of thoughts differ in the meaning
+    of b: in mine, it is constant. In Leo's, it is a variable.
+
+    We need to perform the following steps:
+
+    define variables xL and xU
+    define variables gL and gU for constraints (downward variables)
+
+    add objective function sum_j (u_j - l_j)
+
+    for each constraint a^j x <= b_j in Ax <= b:
+    for each variable x_i contained:
+    depending on sign of a_ji, add constraint on x_i^L or x_i^U
+    (*) add constraints on g_j as well
+
+    solve LP
+
+    If new bounds are better than si's old bounds
+    add OsiColCuts
+
+    PS: We prove in the paper that our schools of thought are very
+    close, and the only two people between them are Fourier and
+    Motzkin
+
+  ******************************************************************/
+
+  // rows, without building it (for the original model)
+
+  if (!extendedModel_) {
+
+    double nFPRows = 0.;
+
+    for (j=0; j<nrows; j++) {
+
+      double nEl = (j==nrows-1) ? (nnz - mbeg [j]) : (mbeg [j+1] - mbeg [j]);
+
+      if (rlb [j] > -COUENNE_INFINITY) nFPRows += nEl;
+      if (rub [j] <  COUENNE_INFINITY) nFPRows += nEl;
+    }
+
+    if (nFPRows > (double) INT_MAX) {
+      printf ("FPLP has %g rows, more than Cplex allows\n", nFPRows);
+      return NULL;
+    }
+  }
+
+  fplp = CPXcreateprob (env, &status, "FixPointLP");
+
+#ifdef DEBUG
+  for (i=0; i<ncols; i++) 
+    printf ("----------- x_%d in [%g,%g]\n", i, lb [i], ub [i]);
+#endif
+
+  double
+    plus_one  =  1.,
+    minus_one = -1.,
+    zero      =  0.,
+    pInf      =  DBL_MAX,
+    mInf      = -DBL_MAX;
+
+  // add lvars and uvars to the new problem
+  for (i=0; i<ncols; i++)   status = CPXnewcols (env, fplp, 1, &minus_one, lb + i, ub + i, NULL, NULL); /*fplp -> addCol (0, NULL, NULL, lb [i], ub [i], -1.); // xL_i*/
+  for (i=0; i<ncols; i++)   status = CPXnewcols (env, fplp, 1,  &plus_one, lb + i, ub + i, NULL, NULL); /*fplp -> addCol (0, NULL, NULL, lb [i], ub [i], +1.); // xU_i*/
+
+  if (extendedModel_) {
+
+    for (j=0; j<nrows; j++) status = CPXnewcols (env, fplp, 1, &zero, rlb + j, &pInf, NULL, NULL); /*fplp -> addCol (0, NULL, NULL, rlb [j],      DBL_MAX, 0.); // bL_j*/
+    for (j=0; j<nrows; j++) status = CPXnewcols (env, fplp, 1, &zero, &mInf, rub + j, NULL, NULL); /*fplp -> addCol (0, NULL, NULL, -DBL_MAX, rub [j],     0.); // bU_j*/
+  }
+
+  // Scan each row of the matrix 
+
+  coe = mval;
+  ind = mind;
+
+  for (j=0; j<nrows; j++) { // for each row
+
+    //printf ("checking mbeg[%d]-mbeg[%d]\n", j+1, j);
+    //printf ("--> %d-%d\n", mbeg[j+1], mbeg[j]);
+
+    int nEl = (j==nrows-1) ? (nnz - mbeg [j]) : (mbeg [j+1] - mbeg [j]);
+
+    if (!nEl)
+      continue;
+
+#ifdef DEBUG
+
+    printf ("row %4d, %4d elements: ", j, nEl);
+
+    for (i=0; i<nEl; i++) {
+      printf ("%+g x%d ", coe [i], ind [i]);
+      fflush (stdout);
+    }
+
+    printf ("in [%g,%g]\n", rlb [j], rub [j]);
+#endif
+
+    // create cuts for the xL and xU elements //////////////////////
+
+    if (extendedModel_ || (rlb [j] > -COUENNE_INFINITY))
+      for (i=0; i<nEl; i++) 
+	createRow (-1, ind [i], ncols, fplp, env, ind, coe, rlb [j], nEl, extendedModel_, j, nrows); // downward constraints -- on x_i
+
+    if (extendedModel_ || (rub [j] <  COUENNE_INFINITY))
+      for (i=0; i<nEl; i++) 
+	createRow (+1, ind [i], ncols, fplp, env, ind, coe, rub [j], nEl, extendedModel_, j, nrows); // downward constraints -- on x_i
+
+    // create (at most 2) cuts for the bL and bU elements //////////////////////
+
+    if (extendedModel_) {
+      createRow (-1, 2*ncols         + j, ncols, fplp, env, ind, coe, rlb [j], nEl, extendedModel_, j, nrows); // upward constraints -- on bL_i
+      createRow (+1, 2*ncols + nrows + j, ncols, fplp, env, ind, coe, rub [j], nEl, extendedModel_, j, nrows); // upward constraints -- on bU_i
+    }
+
+    ind += nEl;
+    coe += nEl;
+  }
+
+  // finally, add consistency cuts, bL <= bU
+
+  if (extendedModel_)
+
+    for (j=0; j<nrows; j++) { // for each row
+
+      int    ind [2] = {2*ncols + j, 2*ncols + nrows + j};
+      double coe [2] = {1.,      -1.};
+      int    beg [2] = {0,2};
+      char sense = 'L';
+
+      status = CPXaddrows (env, fplp, 0, 1, 2, &zero, &sense, beg, ind, coe, NULL, NULL);
+    }
+
+  /// Now we have an fbbt-fixpoint LP problem, to be maximized
+
+  status = CPXchgobjsen (env, fplp, CPX_MAX);
+
+  return fplp;
+}
+
+/* number of nonzeros of the FPLP of the given rows, computed without
+   building it: each finite side of a row with nEl elements gives nEl
+   FPLP rows with nEl elements each */
+
+double fplpNumNz (int nrows,
+		  int nnz,
+		  const int *mbeg,
+		  const double *rlb,
+		  const double *rub) {
+
+  double nz = 0.;
+
+  int j;
+
+  for (j=0; j<nrows; j++) {
+
+    double nEl = (j==nrows-1) ? (nnz - mbeg [j]) : (mbeg [j+1] - mbeg [j]);
+
+    if (rlb [j] > -COUENNE_INFINITY) nz += nEl * nEl;
+    if (rub [j] <  COUENNE_INFINITY) nz += nEl * nEl;
+  }
+
+  return nz;
+}
+
+/* translate Cplex's (sense, rhs, rng) into row bounds [rlb, rub]. On
+   input rlb holds the rhs and rub the ranges, and they can be the
+   same arrays as rhs and rng */
+
+int rowBounds (int nrows,
+	       const char *sense,
+	       double *rlb,
+	       double *rub) {
+
+  int i;
+
+  for (i=0; i<nrows; ++i)
+
+    switch (sense [i]) {
+
+    case 'L': rub [i] = rlb [i]; rlb [i] = -DBL_MAX; break; /* [a,0] --> [-inf, a]    */
+    case 'E': rub [i] = rlb [i];                     break; /* [a,0] --> [a,    a]    */
+    case 'G': rub [i] = DBL_MAX;                     break; /* [a,0] --> [a,    +inf] */
+    case 'R': rub [i] += rlb [i];                    break; /* [a,b] --> [a,    a+b]  */
+
+    default: printf ("Constraint %d has undefined sense\n", i); 
+      return -1;
+    }
+
+  return 0;
+}
+
+/* compute the fixpoint bounds of the given rows and column bounds
+   into sol (xL, then xU). Difference rows are propagated on a graph
+   if so requested, and only the others go to the FPLP. Large FPLPs
+   are solved matrix-free if so requested; only certified bounds are
+   returned, otherwise fall back to building the FPLP and solving it
+   with Cplex, in row chunks if it is over the memory budget. If built
+   whole, the FPLP is returned in *fplp_p (NULL otherwise) and must be
+   freed by the caller. Returns true if the bounds in sol are valid */
+
+int fixpointBounds (CPXCENVptr env,
+		    struct option_s *options,
+		    int ncols,
+		    int nrows,
+		    int nnz,
+		    const int *mbeg,
+		    const int *mind,
+		    const double *mval,
+		    const double *rlb,
+		    const double *rub,
+		    const double *lb,
+		    const double *ub,
+		    double *sol,
+		    CPXLPptr *fplp_p) {
+
+  int status;
+
+  double budget;
+
+  *fplp_p = NULL;
+
+  if (options -> diffGraph &&
+      ((status = diffFixpoint (env, options, ncols, nrows, nnz, mbeg, mind, mval, rlb, rub, lb, ub, sol)) >= 0))
+    return status;
+
+  if ((options -> mfThreshold >= 0) &&
+      (fplpNumNz (nrows, nnz, mbeg, rlb, rub) >= (double) options -> mfThreshold) &&
+      mfFixpoint (ncols, nrows, nnz, mbeg, mind, mval, rlb, rub, lb, ub, sol, options -> mfIterations, options -> nThreads))
+    return 1;
+
+  if ((options -> fplpMemory > 0. || options -> rssCap > 0.) &&
+      ((budget = fplpBudget (options)) >= 0.) &&
+      (fplpMemory (ncols, nrows, nnz, mbeg, rlb, rub) > budget))
+    return chunkedFixpoint (env, ncols, nrows, nnz, mbeg, mind, mval, rlb, rub, lb, ub, sol, budget, options -> budget);
+
+  if (!budgetBuild (options -> budget, fplpNumNz (nrows, nnz, mbeg, rlb, rub)) ||
+      !(*fplp_p = createFPLP (env, ncols, nrows, nnz, mbeg, mind, mval, rlb, rub, lb, ub, 0)))
+    return 0;
+
+#ifdef DEBUG
+  {
+    static int nWritten = 0;
+    char fplpname [20];
+    sprintf (fplpname, "fplp-%d.lp", ++nWritten);
+    printf ("(writing lp %s) ", fplpname);
+    status = CPXwriteprob (env, *fplp_p, fplpname, NULL);
+  }
+#endif
+
+                                     //  /|-----------+
+  status = budgetLPopt (env, *fplp_p, options -> budget);  // < |        |
+                                     //  \|-----------+
+
+  // if problem not solved to optimality (or out of budget), bounds
+  // are useless
+
+  if (status || (CPXgetstat (env, *fplp_p) != CPX_STAT_OPTIMAL))
+    return 0;
+
+  return !CPXgetx (env, *fplp_p, sol, 0, 2 * ncols - 1);
+}
+
+/* alternate integer rounding of the fixpoint bounds in sol and
+   re-solves of fplp with the rounded bounds, so that rounding
+   propagates, for at most maxRounds solves (including the one that
+   gave sol), maxTime seconds, or until the work budget of the call
+   (none if NULL) is spent. On return sol has the last valid bounds.
+   Returns the number of rounds performed */
+
+int fplpRoundingRounds (CPXCENVptr env,
+			CPXLPptr fplp,
+			int ncols,
+			const char *ctype,
+			double *sol,
+			int maxRounds,
+			double maxTime,
+			struct budget_s *work) {
+
+  int
+    round, i, nChg,
+    *ind = (int    *) malloc (4 * ncols * sizeof (int));
+
+  char   *lu  = (char   *) malloc (4 * ncols * sizeof (char));
+  double *bd  = (double *) malloc (4 * ncols * sizeof (double)),
+         *old = (double *) malloc (2 * ncols * sizeof (double));
+
+  double time0;
+
+  {
+    struct timeval tv;
+    gettimeofday (&tv, NULL);
+    time0 = (double) tv. tv_sec + (double) tv. tv_usec / 1e6;
+  }
+
+  for (round = 2; round <= maxRounds; round++) {
+
+    int nTight = 0;
+
+    // round integer bounds, and set the columns of those that changed
+
+    for (i=nChg=0; i<ncols; i++) {
+
+      double
+	l = sol [i],
+	u = sol [ncols + i];
+
+      if ((CPX_BINARY  != ctype [i]) &&
+	  (CPX_INTEGER != ctype [i]))
+	continue;
+
+      l = ceil  (l - COUENNE_EPS);
+      u = floor (u + COUENNE_EPS);
+
+      if ((l <= sol [i] + COUENNE_EPS) && (u >= sol [ncols + i] - COUENNE_EPS))
+	continue;
+
+      if (l > u + COUENNE_EPS) // no integer in the interval, stop here
+	break;
+
+      sol [i] = l; sol [ncols + i] = u;
+
+      ind [nChg] = i;         lu [nChg] = 'L'; bd [nChg++] = l;
+      ind [nChg] = i;         lu [nChg] = 'U'; bd [nChg++] = u;
+      ind [nChg] = ncols + i; lu [nChg] = 'L'; bd [nChg++] = l;
+      ind [nChg] = ncols + i; lu [nChg] = 'U'; bd [nChg++] = u;
+    }
+
+    if ((i < ncols) || !nChg)
+      break;
+
+    {
+      struct timeval tv;
+      gettimeofday (&tv, NULL);
+      if ((double) tv. tv_sec + (double) tv. tv_usec / 1e6 - time0 > maxTime)
+	break;
+    }
+
+    memcpy (old, sol, 2 * ncols * sizeof (double));
+
+    CPXchgbds (env, fplp, nChg, ind, lu, bd);
+
+    if (budgetLPopt (env, fplp, work) ||
+	(CPXgetstat (env, fplp) != CPX_STAT_OPTIMAL) ||
+	CPXgetx (env, fplp, sol, 0, 2 * ncols - 1)) {
+
+      memcpy (sol, old, 2 * ncols * sizeof (double)); // rounded bounds are still valid
+      break;
+    }
+
+    for (i=0; i<ncols; i++) {
+      if (sol [i]         > old [i]         + COUENNE_EPS) ++nTight;
+      if (sol [ncols + i] < old [ncols + i] - COUENNE_EPS) ++nTight;
+    }
+
+    printf ("Root rounding round %d: %d rounded bounds, %d new tightenings\n", round, nChg / 4, nTight);
+
+    if (!nTight)
+      break;
+  }
+
+  free (ind);
+  free (lu);
+  free (bd);
+  free (old);
+
+  return round;
+}
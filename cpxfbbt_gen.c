@@ -0,0 +1,371 @@
+/*
+ * Fix point FBBT -- synthetic scalable MIP instances
+ *
+ * Generates, in memory, parameterized instances of four classes:
+ *
+ * knapsack  multi-dimensional knapsack: size binaries, size/10 + 1
+ *           rows, each item in a row with probability density
+ *
+ * cover     set covering: size binaries, size/2 + 1 rows sum x >= 1,
+ *           each column in a row with probability density
+ *
+ * lotsizing capacitated lot sizing: production, setup and inventory
+ *           for P products over T periods (3PT ~ size columns);
+ *           each capacity row contains a fraction density of the
+ *           products
+ *
+ * block     block-angular: blocks of 50 mixed integer columns and 20
+ *           rows of density density, plus 5 linking rows touching
+ *           each column with probability density / 10
+ *
+ * The random generator is part of this file, so that instances only
+ * depend on (type, size, density, seed) and not on the platform.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cplex.h"
+#include "cpxfbbt.h"
+
+#define GEN_BLOCK_COLS 50
+#define GEN_BLOCK_ROWS 20
+#define GEN_LINK_ROWS   5
+#define GEN_LOT_PERIOD_PRODUCTS 10
+
+static unsigned long long genState_ = 1;
+
+static void genSeed (unsigned int seed) {
+
+  genState_ = 0x9E3779B97F4A7C15ULL ^ (unsigned long long) seed;
+
+  if (!genState_)
+    genState_ = 1;
+}
+
+/* uniform in [0,1) (xorshift64*) */
+
+static double genRand () {
+
+  genState_ ^= genState_ >> 12;
+  genState_ ^= genState_ << 25;
+  genState_ ^= genState_ >> 27;
+
+  return (double) ((genState_ * 2685821657736338717ULL) >> 11) / 9007199254740992.;
+}
+
+/* uniform integer in [lo,hi] */
+
+static int genInt (int lo, int hi) {
+
+  return lo + (int) (genRand () * (hi - lo + 1));
+}
+
+/* add a column, return its index */
+
+static int addCol (struct genModel_s *m, double obj, double lb, double ub, char ctype) {
+
+  if (m -> ncols == m -> colcap) {
+
+    m -> colcap = 2 * m -> colcap + 16;
+
+    m -> obj   = (double *) realloc (m -> obj,   m -> colcap * sizeof (double));
+    m -> lb    = (double *) realloc (m -> lb,    m -> colcap * sizeof (double));
+    m -> ub    = (double *) realloc (m -> ub,    m -> colcap * sizeof (double));
+    m -> ctype = (char   *) realloc (m -> ctype, m -> colcap * sizeof (char));
+  }
+
+  m -> obj   [m -> ncols] = obj;
+  m -> lb    [m -> ncols] = lb;
+  m -> ub    [m -> ncols] = ub;
+  m -> ctype [m -> ncols] = ctype;
+
+  return m -> ncols++;
+}
+
+/* add a row with n elements */
+
+static void addRow (struct genModel_s *m, int n, const int *ind, const double *val, char sense, double rhs) {
+
+  if (m -> nrows + 1 >= m -> rowcap) {
+
+    m -> rowcap = 2 * m -> rowcap + 16;
+
+    m -> mbeg  = (int    *) realloc (m -> mbeg,  (m -> rowcap + 1) * sizeof (int));
+    m -> rhs   = (double *) realloc (m -> rhs,    m -> rowcap      * sizeof (double));
+    m -> sense = (char   *) realloc (m -> sense,  m -> rowcap      * sizeof (char));
+  }
+
+  while (m -> nnz + n > m -> nzcap) {
+
+    m -> nzcap = 2 * m -> nzcap + 64;
+
+    m -> mind = (int    *) realloc (m -> mind, m -> nzcap * sizeof (int));
+    m -> mval = (double *) realloc (m -> mval, m -> nzcap * sizeof (double));
+  }
+
+  memcpy (m -> mind + m -> nnz, ind, n * sizeof (int));
+  memcpy (m -> mval + m -> nnz, val, n * sizeof (double));
+
+  m -> mbeg  [m -> nrows]     = m -> nnz;
+  m -> sense [m -> nrows]     = sense;
+  m -> rhs   [m -> nrows++]   = rhs;
+  m -> nnz                   += n;
+  m -> mbeg  [m -> nrows]     = m -> nnz;
+}
+
+static void genKnapsack (struct genModel_s *m, int size, double density, int *ind, double *val) {
+
+  int i, j, n, nrows = size / 10 + 1;
+
+  for (i=0; i<size; i++)
+    addCol (m, -genInt (1, 100), 0., 1., CPX_BINARY);
+
+  for (j=0; j<nrows; j++) {
+
+    double cap = 0.;
+
+    for (i=n=0; i<size; i++)
+      if (genRand () < density) {
+	ind [n]   = i;
+	val [n]   = genInt (1, 100);
+	cap      += val [n++];
+      }
+
+    if (n)
+      addRow (m, n, ind, val, 'L', (int) (cap / 2.));
+  }
+}
+
+static void genCover (struct genModel_s *m, int size, double density, int *ind, double *val) {
+
+  int i, j, n, nrows = size / 2 + 1;
+
+  for (i=0; i<size; i++)
+    addCol (m, genInt (1, 100), 0., 1., CPX_BINARY);
+
+  for (j=0; j<nrows; j++) {
+
+    for (i=n=0; i<size; i++)
+      if (genRand () < density) {
+	ind [n]   = i;
+	val [n++] = 1.;
+      }
+
+    if (!n) {
+      ind [n]   = genInt (0, size - 1);
+      val [n++] = 1.;
+    }
+
+    addRow (m, n, ind, val, 'G', 1.);
+  }
+}
+
+static void genLotSizing (struct genModel_s *m, int size, double density, int *ind, double *val) {
+
+  int
+    p, t, n,
+    nProd   = GEN_LOT_PERIOD_PRODUCTS,
+    nPer    = size / (3 * nProd) + 1,
+    firstX  = m -> ncols,
+    firstY  = firstX + nProd * nPer,
+    firstS  = firstY + nProd * nPer;
+
+  double *demand = (double *) malloc (nProd * nPer * sizeof (double));
+
+  double bigM = 0.;
+
+  for (p=0; p<nProd*nPer; p++)
+    bigM += (demand [p] = genInt (0, 50));
+
+  for (p=0; p<nProd*nPer; p++) addCol (m, genInt (1, 10),    0., bigM, CPX_CONTINUOUS); // production
+  for (p=0; p<nProd*nPer; p++) addCol (m, genInt (50, 200),  0., 1.,   CPX_BINARY);     // setup
+  for (p=0; p<nProd*nPer; p++) addCol (m, 1.,                0., bigM, CPX_CONTINUOUS); // inventory
+
+  for (t=0; t<nPer; t++) {
+
+    for (p=0; p<nProd; p++) {
+
+      int k = p * nPer + t;
+
+      // balance: s_{p,t-1} + x_pt - s_pt = d_pt
+
+      n = 0;
+      if (t) {ind [n] = firstS + k - 1; val [n++] = 1.;}
+      ind [n] = firstX + k; val [n++] =  1.;
+      ind [n] = firstS + k; val [n++] = -1.;
+
+      addRow (m, n, ind, val, 'E', demand [k]);
+
+      // setup: x_pt <= M y_pt
+
+      ind [0] = firstX + k; val [0] =  1.;
+      ind [1] = firstY + k; val [1] = -bigM;
+
+      addRow (m, 2, ind, val, 'L', 0.);
+    }
+
+    // capacity, on a random subset of the products
+
+    for (p=n=0; p<nProd; p++)
+      if (!p || (genRand () < density)) {
+	ind [n]   = firstX + p * nPer + t;
+	val [n++] = genInt (1, 3);
+      }
+
+    addRow (m, n, ind, val, 'L', 40. * n);
+  }
+
+  free (demand);
+}
+
+static void genBlock (struct genModel_s *m, int size, double density, int *ind, double *val) {
+
+  int
+    b, i, j, n,
+    nBlocks = size / GEN_BLOCK_COLS + 1;
+
+  for (i=0; i<nBlocks * GEN_BLOCK_COLS; i++)
+    addCol (m, -genInt (1, 20), 0., genInt (1, 10), (i % 2) ? CPX_INTEGER : CPX_CONTINUOUS);
+
+  for (b=0; b<nBlocks; b++)
+    for (j=0; j<GEN_BLOCK_ROWS; j++) {
+
+      double act = 0.;
+
+      for (i=n=0; i<GEN_BLOCK_COLS; i++)
+	if (genRand () < density) {
+	  ind [n]   = b * GEN_BLOCK_COLS + i;
+	  val [n]   = genInt (-5, 10);
+	  if (val [n] == 0.) val [n] = 1.;
+	  act      += (val [n] > 0.) ? val [n] * m -> ub [ind [n]] : 0.;
+	  ++n;
+	}
+
+      if (n)
+	addRow (m, n, ind, val, 'L', (int) (act / 3.));
+    }
+
+  for (j=0; j<GEN_LINK_ROWS; j++) {
+
+    double act = 0.;
+
+    for (i=n=0; i<nBlocks * GEN_BLOCK_COLS; i++)
+      if (genRand () < density / 10.) {
+	ind [n]   = i;
+	val [n]   = genInt (1, 5);
+	act      += val [n] * m -> ub [i];
+	++n;
+      }
+
+    if (n)
+      addRow (m, n, ind, val, 'L', (int) (act / 2.));
+  }
+}
+
+/* generate an instance of the given type ("knapsack", "cover",
+   "lotsizing", "block"). Returns 0 on success, -1 for unknown types */
+
+int genModel (const char *type, int size, double density, unsigned int seed, struct genModel_s *m) {
+
+  int    *ind;
+  double *val;
+
+  memset (m, 0, sizeof (struct genModel_s));
+
+  if (size < 1)       size    = 1;
+  if (density <= 0.)  density = 1e-3;
+  if (density >  1.)  density = 1.;
+
+  genSeed (seed);
+
+  ind = (int    *) malloc ((size + GEN_BLOCK_COLS + 3) * sizeof (int));
+  val = (double *) malloc ((size + GEN_BLOCK_COLS + 3) * sizeof (double));
+
+  if      (!strcmp (type, "knapsack"))  genKnapsack  (m, size, density, ind, val);
+  else if (!strcmp (type, "cover"))     genCover     (m, size, density, ind, val);
+  else if (!strcmp (type, "lotsizing")) genLotSizing (m, size, density, ind, val);
+  else if (!strcmp (type, "block"))     genBlock     (m, size, density, ind, val);
+  else {
+    printf ("Unknown instance type %s\n", type);
+    free (ind);
+    free (val);
+    return -1;
+  }
+
+  free (ind);
+  free (val);
+
+  return 0;
+}
+
+/* write a term of a linear expression, wrapping long lines */
+
+static void writeTerm (FILE *f, double coe, int index, int *nTerms) {
+
+  if (*nTerms && !(*nTerms % 8))
+    fprintf (f, "\n   ");
+
+  fprintf (f, " %c %.17g x%d", (coe < 0.) ? '-' : '+', (coe < 0.) ? -coe : coe, index);
+
+  ++*nTerms;
+}
+
+/* write the instance in LP format */
+
+void genWriteLP (FILE *f, const struct genModel_s *m) {
+
+  int i, j, p, n;
+
+  fprintf (f, "\\ synthetic instance: %d rows, %d columns, %d nonzeros\n\nMinimize\n obj:", m -> nrows, m -> ncols, m -> nnz);
+
+  for (i=n=0; i<m->ncols; i++)
+    if (m -> obj [i] != 0.)
+      writeTerm (f, m -> obj [i], i, &n);
+
+  fprintf (f, "\n\nSubject To\n");
+
+  for (j=0; j<m->nrows; j++) {
+
+    fprintf (f, " c%d:", j);
+
+    for (p=m->mbeg [j], n=0; p<m->mbeg [j+1]; p++)
+      writeTerm (f, m -> mval [p], m -> mind [p], &n);
+
+    fprintf (f, " %s %.17g\n", (m -> sense [j] == 'L') ? "<=" : (m -> sense [j] == 'G') ? ">=" : "=", m -> rhs [j]);
+  }
+
+  fprintf (f, "\nBounds\n");
+
+  for (i=0; i<m->ncols; i++)
+    if (m -> ctype [i] != CPX_BINARY)
+      fprintf (f, " %.17g <= x%d <= %.17g\n", m -> lb [i], i, m -> ub [i]);
+
+  fprintf (f, "\nGenerals\n");
+
+  for (i=n=0; i<m->ncols; i++)
+    if (m -> ctype [i] == CPX_INTEGER)
+      fprintf (f, "%s x%d", (++n % 10) ? "" : "\n", i);
+
+  fprintf (f, "\n\nBinaries\n");
+
+  for (i=n=0; i<m->ncols; i++)
+    if (m -> ctype [i] == CPX_BINARY)
+      fprintf (f, "%s x%d", (++n % 10) ? "" : "\n", i);
+
+  fprintf (f, "\n\nEnd\n");
+}
+
+void genFree (struct genModel_s *m) {
+
+  free (m -> mbeg);
+  free (m -> mind);
+  free (m -> mval);
+  free (m -> rhs);
+  free (m -> sense);
+  free (m -> obj);
+  free (m -> lb);
+  free (m -> ub);
+  free (m -> ctype);
+}
@@ -0,0 +1,68 @@
+/*
+ * Fix point FBBT -- write a synthetic MIP instance in LP format
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cplex.h"
+#include "cmdline.h"
+#include "cpxfbbt.h"
+
+int main (int argc, char **argv) {
+
+  struct genModel_s m;
+
+  int i, size, seed;
+
+  double density;
+
+  char
+    ifHelp = 0,
+    **filenames,
+    *type = (char *) malloc (sizeof (char));
+
+  FILE *f = stdout;
+
+  tpar options [] = {{ 'y',  CSTR() "type",       0, &type,    TSTRING, CSTR() "Instance type: knapsack, cover, lotsizing, block"}
+		     ,{'n',  CSTR() "size",     1e3, &size,    TINT,    CSTR() "Approximate number of columns (default: 1000)"}
+		     ,{'r',  CSTR() "density", 0.05, &density, TDOUBLE, CSTR() "Row density (default: 0.05)"}
+		     ,{'s',  CSTR() "seed",       1, &seed,    TINT,    CSTR() "Random seed (default: 1)"}
+		     ,{'h',  CSTR() "help",       0, &ifHelp,  TTOGGLE, CSTR() "Print this help and exit"}
+		     ,{0,    CSTR() "",           0, NULL,     TTOGGLE, CSTR() ""} // THIS ENTRY ALWAYS AT THE END
+  };
+
+  set_default_args (options);
+
+  filenames = readargs (argc, argv, options);
+
+  if (ifHelp || !*type) {
+    print_help (argv [0], options);
+    printf ("The instance is written to the file given, or to stdout\n");
+    free (type);
+    return 0;
+  }
+
+  if (filenames && !(f = fopen (*filenames, "w"))) {
+    printf ("Could not open %s\n", *filenames);
+    return -1;
+  }
+
+  if (!genModel (type, size, density, (unsigned int) seed, &m)) {
+    genWriteLP (f, &m);
+    genFree (&m);
+  }
+
+  if (filenames) {
+
+    fclose (f);
+
+    for (i=0; filenames [i]; ++i)
+      free (filenames [i]);
+    free (filenames);
+  }
+
+  free (type);
+
+  return 0;
+}
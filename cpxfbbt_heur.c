@@ -0,0 +1,628 @@
+/*
+ * Fix point FBBT as a cutting plane in Cplex -- fix-and-propagate
+ * heuristic
+ *
+ * Integer variables are fixed one at a time to the rounding of their
+ * node LP value, most integral first, and bounds are propagated over
+ * the rows of the model after each fixing. If propagation proves a
+ * fixing infeasible, the other rounding is tried; when both fail the
+ * dive backtracks, up to a maximum number of backtracks. Once all
+ * integers are fixed, continuous variables (if any) are set by an LP
+ * on a copy of the model. Any completion is handed to Cplex, which
+ * checks it before accepting it as an incumbent.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#include <sys/time.h>
+
+#include "cplex.h"
+#include "cpxfbbt.h"
+
+//#define DEBUG
+
+#define COUENNE_EPS 1e-5
+#define HEUR_FEASTOL 1e-6
+#define HEUR_MINCHG  1e-3 // minimum relative change of a continuous bound to record it
+
+/* model rows and columns, read at the first call and kept until the
+   stats call */
+
+static int
+  ncols_ = 0,
+  nrows_ = 0,
+  *mbeg_ = NULL, // rows (mbeg_ has nrows_+1 entries)
+  *mind_ = NULL,
+  *cbeg_ = NULL, // columns (cbeg_ has ncols_+1 entries)
+  *crow_ = NULL,
+  nInt_  = 0,
+  nCont_ = 0;
+
+static double
+  *mval_ = NULL,
+  *rlb_  = NULL,
+  *rub_  = NULL,
+  *obj_  = NULL;
+
+static char *ctype_ = NULL;
+
+static CPXLPptr lp_ = NULL; // LP copy of the model for continuous completions
+
+static pthread_mutex_t lock_ = PTHREAD_MUTEX_INITIALIZER; // one dive at a time
+
+static char disabled_ = 0; // the model could not be read
+
+static int
+  nCalls_   = 0,
+  nSols_    = 0,
+  nBackTr_  = 0;
+
+static double cpuTime_ = 0.;
+
+/** \struct trail_s
+ *  \brief a bound changed during the dive, and its previous value
+ */
+
+struct trail_s {
+
+  int    col;
+  char   upper;
+  double old;
+};
+
+/* dive state */
+
+struct dive_s {
+
+  double *lb, *ub;
+
+  struct trail_s *trail;
+  int nTrail, trailCap;
+
+  int *queue, qHead, qSize; // circular queue of rows to propagate
+  char *inQueue;
+};
+
+static void pushRow (struct dive_s *d, int row) {
+
+  if (d -> inQueue [row])
+    return;
+
+  d -> inQueue [row] = 1;
+  d -> queue [(d -> qHead + d -> qSize++) % nrows_] = row;
+}
+
+/* change a bound, recording it on the trail and queueing the rows of
+   its column. Returns 0 if the bound crosses the other one */
+
+static int setBound (struct dive_s *d, int col, char upper, double val) {
+
+  int q;
+
+  if (d -> nTrail == d -> trailCap) {
+    d -> trailCap = 2 * d -> trailCap + 16;
+    d -> trail    = (struct trail_s *) realloc (d -> trail, d -> trailCap * sizeof (struct trail_s));
+  }
+
+  d -> trail [d -> nTrail]. col   = col;
+  d -> trail [d -> nTrail]. upper = upper;
+  d -> trail [d -> nTrail++]. old = upper ? d -> ub [col] : d -> lb [col];
+
+  if (upper) d -> ub [col] = val;
+  else       d -> lb [col] = val;
+
+  for (q = cbeg_ [col]; q < cbeg_ [col+1]; q++)
+    pushRow (d, crow_ [q]);
+
+  return (d -> lb [col] <= d -> ub [col] + HEUR_FEASTOL);
+}
+
+/* undo bound changes back to trail position mark */
+
+static void undo (struct dive_s *d, int mark) {
+
+  while (d -> nTrail > mark) {
+
+    struct trail_s *t = d -> trail + --(d -> nTrail);
+
+    if (t -> upper) d -> ub [t -> col] = t -> old;
+    else            d -> lb [t -> col] = t -> old;
+  }
+}
+
+/* tighten the bound of column col implied by a*x_col <= rhs. Returns
+   0 if infeasible */
+
+static int implied (struct dive_s *d, int col, double a, double rhs) {
+
+  double bd = rhs / a;
+
+  char isInt = (CPX_BINARY == ctype_ [col]) || (CPX_INTEGER == ctype_ [col]);
+
+  if (a > 0.) {
+
+    double u = d -> ub [col];
+
+    if (isInt)
+      bd = floor (bd + COUENNE_EPS);
+
+    if (bd < d -> lb [col] - HEUR_FEASTOL * (1. + fabs (d -> lb [col])))
+      return 0;
+
+    if (bd < d -> lb [col])
+      bd = d -> lb [col];
+
+    if ((bd < u - HEUR_FEASTOL) &&
+	(isInt || (bd < u - HEUR_MINCHG * ((fabs (u) < 1.) ? 1. : fabs (u)))))
+      return setBound (d, col, 1, bd);
+
+  } else {
+
+    double l = d -> lb [col];
+
+    if (isInt)
+      bd = ceil (bd - COUENNE_EPS);
+
+    if (bd > d -> ub [col] + HEUR_FEASTOL * (1. + fabs (d -> ub [col])))
+      return 0;
+
+    if (bd > d -> ub [col])
+      bd = d -> ub [col];
+
+    if ((bd > l + HEUR_FEASTOL) &&
+	(isInt || (bd > l + HEUR_MINCHG * ((fabs (l) < 1.) ? 1. : fabs (l)))))
+      return setBound (d, col, 0, bd);
+  }
+
+  return 1;
+}
+
+/* activity based bound propagation on the queued rows, for at most
+   maxVisits row visits. Returns 0 if infeasible */
+
+static int propagate (struct dive_s *d, int maxVisits) {
+
+  while (d -> qSize && (maxVisits-- > 0)) {
+
+    int
+      p, r = d -> queue [d -> qHead],
+      nInfMin = 0, nInfMax = 0;
+
+    double minAct = 0., maxAct = 0.;
+
+    d -> qHead = (d -> qHead + 1) % nrows_;
+    d -> qSize--;
+    d -> inQueue [r] = 0;
+
+    for (p = mbeg_ [r]; p < mbeg_ [r+1]; p++) {
+
+      double
+	a = mval_ [p],
+	l = d -> lb [mind_ [p]],
+	u = d -> ub [mind_ [p]];
+
+      if (a > 0.) {
+	if (l <= -CPX_INFBOUND) ++nInfMin; else minAct += a * l;
+	if (u >=  CPX_INFBOUND) ++nInfMax; else maxAct += a * u;
+      } else {
+	if (u >=  CPX_INFBOUND) ++nInfMin; else minAct += a * u;
+	if (l <= -CPX_INFBOUND) ++nInfMax; else maxAct += a * l;
+      }
+    }
+
+    if ((!nInfMin && (rub_ [r] <  CPX_INFBOUND) && (minAct > rub_ [r] + HEUR_FEASTOL * (1. + fabs (rub_ [r])))) ||
+	(!nInfMax && (rlb_ [r] > -CPX_INFBOUND) && (maxAct < rlb_ [r] - HEUR_FEASTOL * (1. + fabs (rlb_ [r])))))
+      return 0;
+
+    // bounds implied on each column by the other columns' activity
+
+    for (p = mbeg_ [r]; p < mbeg_ [r+1]; p++) {
+
+      int    col = mind_ [p];
+      double
+	a = mval_ [p],
+	l = d -> lb [col],
+	u = d -> ub [col],
+	lo = (a > 0.) ? l : u, // bound giving the minimum activity
+	hi = (a > 0.) ? u : l;
+
+      // a x_col <= rub - (min activity of the others)
+
+      if ((rub_ [r] < CPX_INFBOUND) &&
+	  ((nInfMin == 0) || ((nInfMin == 1) && (fabs (lo) >= CPX_INFBOUND)))) {
+
+	double rest = minAct - ((fabs (lo) >= CPX_INFBOUND) ? 0. : a * lo);
+
+	if (!implied (d, col, a, rub_ [r] - rest))
+	  return 0;
+      }
+
+      // a x_col >= rlb - (max activity of the others), i.e., -a x_col <= ...
+
+      if ((rlb_ [r] > -CPX_INFBOUND) &&
+	  ((nInfMax == 0) || ((nInfMax == 1) && (fabs (hi) >= CPX_INFBOUND)))) {
+
+	double rest = maxAct - ((fabs (hi) >= CPX_INFBOUND) ? 0. : a * hi);
+
+	if (!implied (d, col, -a, rest - rlb_ [r]))
+	  return 0;
+      }
+    }
+  }
+
+  return 1;
+}
+
+/* fix col to val and propagate. Returns 0 if infeasible, leaving the
+   queue empty */
+
+static int fixCol (struct dive_s *d, int col, double val) {
+
+  if (setBound  (d, col, 0, val) &&
+      setBound  (d, col, 1, val) &&
+      propagate (d, 10 * nrows_))
+    return 1;
+
+  for (; d -> qSize; d -> qSize--) {
+    d -> inQueue [d -> queue [d -> qHead]] = 0;
+    d -> qHead = (d -> qHead + 1) % nrows_;
+  }
+
+  return 0;
+}
+
+/* read the model at the first call. Returns 0 on failure */
+
+static int heurInit (CPXCENVptr env, CPXCLPptr origLP) {
+
+  int
+    i, p, nnz, suffspace, status,
+    *cnt;
+
+  char *sense;
+
+  ncols_ = CPXgetnumcols (env, origLP);
+  nrows_ = CPXgetnumrows (env, origLP);
+  nnz    = CPXgetnumnz   (env, origLP);
+
+  mbeg_  = (int    *) malloc ((1 + nrows_) * sizeof (int));
+  mind_  = (int    *) malloc ((1 + nnz)    * sizeof (int));
+  mval_  = (double *) malloc ((1 + nnz)    * sizeof (double));
+  rlb_   = (double *) malloc ((1 + nrows_) * sizeof (double));
+  rub_   = (double *) malloc ((1 + nrows_) * sizeof (double));
+  obj_   = (double *) malloc ((1 + ncols_) * sizeof (double));
+  ctype_ = (char   *) malloc ((1 + ncols_) * sizeof (char));
+  cbeg_  = (int    *) calloc ((2 + ncols_),  sizeof (int));
+  crow_  = (int    *) malloc ((1 + nnz)    * sizeof (int));
+  sense  = (char   *) malloc ((1 + nrows_) * sizeof (char));
+  cnt    = (int    *) malloc ((1 + ncols_) * sizeof (int));
+
+  status =
+    CPXgetrows    (env, origLP, &nnz, mbeg_, mind_, mval_, nnz, &suffspace, 0, nrows_-1) ||
+    CPXgetrhs     (env, origLP, rlb_,  0, nrows_-1) ||
+    CPXgetrngval  (env, origLP, rub_,  0, nrows_-1) ||
+    CPXgetsense   (env, origLP, sense, 0, nrows_-1) ||
+    CPXgetobj     (env, origLP, obj_,  0, ncols_-1) ||
+    CPXgetctype   (env, origLP, ctype_, 0, ncols_-1) ||
+    rowBounds     (nrows_, sense, rlb_, rub_);
+
+  mbeg_ [nrows_] = nnz;
+
+  // column-wise copy of the row indices
+
+  for (p=0; p<nnz; p++)
+    ++cbeg_ [mind_ [p] + 1];
+
+  for (i=0; i<ncols_; i++) {
+    cbeg_ [i+1] += cbeg_ [i];
+    cnt [i] = cbeg_ [i];
+  }
+
+  for (i=0; i<nrows_; i++)
+    for (p = mbeg_ [i]; p < mbeg_ [i+1]; p++)
+      crow_ [cnt [mind_ [p]]++] = i;
+
+  for (i=0; i<ncols_; i++)
+    if ((CPX_BINARY  == ctype_ [i]) ||
+	(CPX_INTEGER == ctype_ [i])) ++nInt_;
+    else                             ++nCont_;
+
+  // LP copy for completing continuous variables
+
+  if (!status && nCont_ &&
+      (!(lp_ = CPXcloneprob (env, origLP, &status)) ||
+       CPXchgprobtype (env, lp_, CPXPROB_LP)))
+    status = 1;
+
+  free (sense);
+  free (cnt);
+
+  return !status;
+}
+
+static int cmpFrac (const void *a, const void *b) {
+
+  double
+    fa = ((const double *) a) [0],
+    fb = ((const double *) b) [0];
+
+  return (fa < fb) ? -1 : (fa > fb) ? 1 : 0;
+}
+
+/* complete the dive's fixings into a solution in x, with its
+   objective in *objval_p. Returns 0 on failure */
+
+static int complete (CPXCENVptr env, struct dive_s *d, double *x, double *objval_p) {
+
+  int i;
+
+  if (!nCont_) {
+
+    *objval_p = 0.;
+
+    for (i=0; i<ncols_; i++)
+      *objval_p += obj_ [i] * (x [i] = d -> lb [i]);
+
+    return 1;
+  }
+
+  {
+    int    *ind = (int    *) malloc (2 * ncols_ * sizeof (int));
+    char   *lu  = (char   *) malloc (2 * ncols_ * sizeof (char));
+    double *bd  = (double *) malloc (2 * ncols_ * sizeof (double));
+
+    int status;
+
+    for (i=0; i<ncols_; i++) {
+      ind [2*i]   = ind [2*i+1] = i;
+      lu  [2*i]   = 'L'; bd [2*i]   = d -> lb [i];
+      lu  [2*i+1] = 'U'; bd [2*i+1] = d -> ub [i];
+    }
+
+    status =
+      CPXchgbds (env, lp_, 2 * ncols_, ind, lu, bd) ||
+      CPXlpopt  (env, lp_) ||
+      (CPXgetstat (env, lp_) != CPX_STAT_OPTIMAL) ||
+      CPXgetx      (env, lp_, x, 0, ncols_-1) ||
+      CPXgetobjval (env, lp_, objval_p);
+
+    free (ind);
+    free (lu);
+    free (bd);
+
+    return !status;
+  }
+}
+
+/* heuristic callback. Called with cbdata, cbhandle and useraction_p
+   NULL, print statistics and free the cached model */
+
+int fixpropHeur (CPXCENVptr env,
+		 void *cbdata,
+		 int wherefrom,
+		 void *cbhandle,
+		 double *objval_p,
+		 double *x,
+		 int *checkfeas_p,
+		 int *useraction_p) {
+
+  struct option_s *options = (struct option_s *) cbhandle;
+
+  struct dive_s d;
+
+  CPXCLPptr origLP;
+
+  double
+    time0,
+    *order; // (fractionality, column) pairs
+
+  int
+    i, nOrd,
+    nBack = 0,
+    found = 0,
+    level = 0,
+    *marks, // trail position and alternative tried at each level
+    *cols;
+
+  char *tried;
+
+  {
+    struct timeval tv;
+    gettimeofday (&tv, NULL);
+    time0 = (double) tv. tv_sec + (double) tv. tv_usec / 1e6;
+  }
+
+  if ((NULL == cbdata)   &&
+      (NULL == cbhandle) &&
+      (NULL == useraction_p)) {
+
+    printf ("Fix-and-propagate: %d calls, %d solutions, %d backtracks, time %g\n", nCalls_, nSols_, nBackTr_, cpuTime_);
+
+    if (lp_)
+      CPXfreeprob (env, &lp_);
+
+    free (mbeg_); free (mind_); free (mval_);
+    free (rlb_);  free (rub_);  free (obj_);
+    free (ctype_);
+    free (cbeg_); free (crow_);
+
+    mbeg_ = mind_ = cbeg_ = crow_ = NULL;
+    mval_ = rlb_  = rub_  = obj_  = NULL;
+    ctype_ = NULL;
+    ncols_ = nrows_ = nInt_ = nCont_ = 0;
+
+    nCalls_ = nSols_ = nBackTr_ = 0;
+    cpuTime_  = 0.;
+    disabled_ = 0;
+
+    return 0;
+  }
+
+  *useraction_p = CPX_CALLBACK_DEFAULT;
+
+  if (disabled_ ||
+      (options -> heurFrequency <= 0) ||
+      pthread_mutex_trylock (&lock_)) // another thread is diving
+    return 0;
+
+  if (nCalls_++ % options -> heurFrequency) {
+    pthread_mutex_unlock (&lock_);
+    return 0;
+  }
+
+  if (CPXgetcallbacklp (env, cbdata, wherefrom, &origLP) ||
+      (!mbeg_ && !heurInit (env, origLP)) ||
+      (CPXgetnumcols (env, origLP) != ncols_) ||
+      !nrows_) {
+
+    disabled_ = 1;
+    pthread_mutex_unlock (&lock_);
+    return 0;
+  }
+
+  d.lb       = (double *) malloc (ncols_ * sizeof (double));
+  d.ub       = (double *) malloc (ncols_ * sizeof (double));
+  d.queue    = (int    *) malloc (nrows_ * sizeof (int));
+  d.inQueue  = (char   *) calloc (nrows_,  sizeof (char));
+  d.trail    = NULL;
+  d.nTrail   = d.trailCap = d.qHead = d.qSize = 0;
+
+  order = (double *) malloc (2 * nInt_   * sizeof (double));
+  cols  = (int    *) malloc ((1 + nInt_) * sizeof (int));
+  marks = (int    *) malloc ((1 + nInt_) * sizeof (int));
+  tried = (char   *) malloc ((1 + nInt_) * sizeof (char));
+
+  CPXgetcallbacknodelb (env, cbdata, wherefrom, d.lb, 0, ncols_-1);
+  CPXgetcallbacknodeub (env, cbdata, wherefrom, d.ub, 0, ncols_-1);
+
+  // fix most integral variables first
+
+  for (i=nOrd=0; i<ncols_; i++)
+    if ((CPX_BINARY  == ctype_ [i]) ||
+	(CPX_INTEGER == ctype_ [i])) {
+      order [2*nOrd]     = fabs (x [i] - floor (x [i] + .5));
+      order [2*nOrd + 1] = (double) i;
+      ++nOrd;
+    }
+
+  qsort (order, nOrd, 2 * sizeof (double), cmpFrac);
+
+  for (i=0; i<nOrd; i++)
+    cols [i] = (int) order [2*i + 1];
+
+  for (i=0; i<nrows_; i++)
+    pushRow (&d, i);
+
+  if (propagate (&d, 10 * nrows_))
+
+    // depth-first dive; level is the position in cols, and at each
+    // level the rounding of x is tried first, then the other value
+
+    while (1) {
+
+      int col, ok;
+      double val;
+
+      while ((level < nOrd) &&
+	     (d.ub [cols [level]] - d.lb [cols [level]] < .5)) // fixed by propagation
+	marks [level++] = -1;
+
+      if (level == nOrd) {
+	found = complete (env, &d, x, objval_p);
+	break;
+      }
+
+      col = cols [level];
+      val = floor (x [col] + .5);
+
+      if (val < d.lb [col]) val = d.lb [col];
+      if (val > d.ub [col]) val = d.ub [col];
+
+      marks [level] = d.nTrail;
+      tried [level] = 0;
+
+      ok = fixCol (&d, col, val);
+
+      while (!ok) {
+
+	// restore this level, then try the other value or backtrack
+
+	undo (&d, marks [level]);
+
+	if (!tried [level]) {
+
+	  tried [level] = 1;
+
+	  // the neighbor of val towards x (the other rounding), or the
+	  // one away from it if val was clamped or x is integer
+
+	  {
+	    double other = (val >= x [col]) ? val - 1. : val + 1.;
+
+	    if ((other < d.lb [col]) || (other > d.ub [col]))
+	      other = 2. * val - other;
+
+	    val = other;
+	  }
+
+	  if ((val >= d.lb [col]) && (val <= d.ub [col]))
+	    ok = fixCol (&d, col, val);
+
+	  continue;
+	}
+
+	if (++nBack > options -> heurBacktracks)
+	  break;
+
+	do --level; while ((level >= 0) && (marks [level] < 0));
+
+	if (level < 0)
+	  break;
+
+	col = cols [level];
+	val = d.lb [col]; // value fixed at this level
+      }
+
+      if (!ok)
+	break;
+
+      ++level;
+    }
+
+  if (found) {
+
+    *checkfeas_p  = 1;
+    *useraction_p = CPX_CALLBACK_SET;
+    ++nSols_;
+
+#ifdef DEBUG
+    printf ("fix-and-propagate: solution %g after %d backtracks\n", *objval_p, nBack);
+#endif
+  }
+
+  nBackTr_ += nBack;
+
+  free (d.lb);
+  free (d.ub);
+  free (d.queue);
+  free (d.inQueue);
+  free (d.trail);
+  free (order);
+  free (cols);
+  free (marks);
+  free (tried);
+
+  {
+    struct timeval tv;
+    gettimeofday (&tv, NULL);
+    cpuTime_ += (double) tv. tv_sec + (double) tv. tv_usec / 1e6 - time0;
+  }
+
+  pthread_mutex_unlock (&lock_);
+
+  return 0;
+}
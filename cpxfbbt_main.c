@@ -12,40 +12,71 @@
 
 #include "cplex.h"
 #include "cmdline.h"
+#include "cpxfbbt.h"
 
-struct option_s {
+static CPXENVptr jobEnv_ = NULL; // in a daemon job, its worker's environment
 
-  int frequency;
-  int maxDepth;
-};
-
-int fixpointfbbt (CPXCENVptr env,
-		  void *cbdata,
-		  int wherefrom,
-		  void *cbhandle,
-		  int *useraction_p);
+static int daemonJob (CPXENVptr env, int argc, char **argv);
 
 int main (int argc, char **argv) {
 
   int status, i;
 
-  CPXENVptr env = CPXopenCPLEX (&status);
+  CPXENVptr env = NULL;
 
-  double maxTime;
+  double maxTime, gap;
 
   char
     addcuts = 0,
-    ifHelp  = 0;
+    ifHelp  = 0,
+    sweep   = 0,
+    *traceName   = (char *) malloc (sizeof (char)),
+    *historyName = (char *) malloc (sizeof (char)),
+    *configNames = (char *) malloc (sizeof (char)),
+    *cacheDir    = (char *) malloc (sizeof (char)),
+    *daemonSock  = (char *) malloc (sizeof (char));
+
+  int presolve, nRace, cacheHit = 0, nJobs;
 
-  int presolve;
+  double cacheSaved = 0.;
 
   struct option_s opt;
 
   tpar options [] = {{ 'f',  CSTR() "fixpt",      0, &addcuts,       TTOGGLE, CSTR() "add fixpoint FBBT (default: off)"}
 		     ,{'p',  CSTR() "presolve",   1, &presolve,      TINT,    CSTR() "Use Cplex's presolve (FBBT): 0 is off, 1 is default, 2 is aggressive -- default: 1"}
 		     ,{'t',  CSTR() "maxtime",   -1, &maxTime,       TDOUBLE, CSTR() "Maximum CPU time (default: no limit)"}
+		     ,{'g',  CSTR() "gap",     1e-4, &gap,           TDOUBLE, CSTR() "Relative gap target (default: 1e-4)"}
 		     ,{'d',  CSTR() "maxdepth",  -1, &opt.maxDepth,  TINT,    CSTR() "Maximum BB depth for applying procedure (default: no limit)"}
 		     ,{'q',  CSTR() "frequency",  1, &opt.frequency, TINT,    CSTR() "Frequency of calls (default: every node if active); negative means stop if first call ineffective"}
+		     ,{'P',  CSTR() "probe",        0, &opt.probe,        TTOGGLE, CSTR() "Probe binaries on the root fixpoint LP (default: off)"}
+		     ,{'b',  CSTR() "probebudget", 1e4, &opt.probeBudget,  TINT,    CSTR() "Maximum simplex iterations for probing (default: 10000)"}
+		     ,{'r',  CSTR() "rounds",       1, &opt.rootRounds,   TINT,    CSTR() "Max FPLP solves alternated with integer rounding at the root (default: 1)"}
+		     ,{'u',  CSTR() "roundtime",   10, &opt.roundTime,    TDOUBLE, CSTR() "Time limit (s) for root rounding rounds (default: 10)"}
+		     ,{'a',  CSTR() "targeted",     0, &opt.targeted,     TTOGGLE, CSTR() "Restrict the FPLP to fractional integers and nonbasic columns with nonzero reduced cost, overrides -E and -Q (default: off)"}
+		     ,{'n',  CSTR() "targethops",   1, &opt.targetHops,   TINT,    CSTR() "Targeted FPLP: keep rows within this many hops of the candidates (default: 1)"}
+		     ,{'A',  CSTR() "targetcheck",  0, &opt.targetCheck,  TTOGGLE, CSTR() "Targeted FPLP: also solve the full FPLP and count missed tightenings (default: off)"}
+		     ,{'s',  CSTR() "pending",      0, &opt.pending,      TTOGGLE, CSTR() "Keep tightenings that do not cut off the LP solution, apply them in the subtree (default: off)"}
+		     ,{'E',  CSTR() "reduce",       0, &opt.reduce,       TTOGGLE, CSTR() "Fold fixed columns into row bounds and drop redundant rows before building the FPLP, also with -Q (default: off)"}
+		     ,{'o',  CSTR() "coeftighten",  0, &opt.coefTighten,  TTOGGLE, CSTR() "Strengthen big-M rows with the root fixpoint bounds, add them as cuts (default: off)"}
+		     ,{'D',  CSTR() "diffgraph",    0, &opt.diffGraph,    TTOGGLE, CSTR() "Propagate two-variable difference rows with shortest paths, only the others with the FPLP (default: off)"}
+		     ,{'Q',  CSTR() "cliques",      0, &opt.cliqueTable,  TTOGGLE, CSTR() "Propagate set packing and partitioning rows on a clique table, only the others with the FPLP, reduced with -E (default: off)"}
+		     ,{'m',  CSTR() "mfthreshold", -1, &opt.mfThreshold,  TINT,    CSTR() "Solve FPLPs with at least this many nonzeros matrix-free (default: -1, never)"}
+		     ,{'i',  CSTR() "mfiter",      1e4, &opt.mfIterations, TINT,    CSTR() "Iteration limit of the matrix-free FPLP solver (default: 10000)"}
+		     ,{'j',  CSTR() "threads",      1, &opt.nThreads,     TINT,    CSTR() "Threads for the matrix-free FPLP solver (default: 1)"}
+		     ,{'M',  CSTR() "fplpmem",     -1, &opt.fplpMemory,   TDOUBLE, CSTR() "Memory budget (MB) of one FPLP, larger ones are solved in row chunks (default: -1, no limit)"}
+		     ,{'X',  CSTR() "rsscap",      -1, &opt.rssCap,       TDOUBLE, CSTR() "Keep resident memory below this (MB) when building FPLPs (default: -1, no cap)"}
+		     ,{'w',  CSTR() "fplpitlim",   -1, &opt.fplpItLimit,  TINT,    CSTR() "Simplex iterations of one separator call, FPLP construction included, abort beyond (default: -1, no limit)"}
+		     ,{'W',  CSTR() "fplpittotal", -1, &opt.fplpItTotal,  TDOUBLE, CSTR() "Simplex iterations of all separator calls, FPLP construction included (default: -1, no limit)"}
+		     ,{'e',  CSTR() "heuristic",    0, &opt.heurFrequency,  TINT,  CSTR() "Run the fix-and-propagate heuristic every this many heuristic callback calls (default: 0, off)"}
+		     ,{'k',  CSTR() "backtracks", 100, &opt.heurBacktracks, TINT,  CSTR() "Maximum backtracks of a fix-and-propagate dive (default: 100)"}
+		     ,{'C',  CSTR() "cache",        0, &cacheDir,         TSTRING, CSTR() "Keep root fixpoint bounds of each model in this directory, and reuse them (default: none)"}
+		     ,{'T',  CSTR() "trace",        0, &traceName,        TSTRING, CSTR() "Record the inputs of every FBBT call into this binary trace (default: none)"}
+		     ,{'R',  CSTR() "race",         0, &nRace,            TINT,    CSTR() "Race this many configurations in parallel processes, keep the first to finish (default: 0, off)"}
+		     ,{'H',  CSTR() "history",      0, &historyName,      TSTRING, CSTR() "Append the winning configuration of a race to this file (default: cpxfbbt_race.hist)"}
+		     ,{'c',  CSTR() "configs",      0, &configNames,      TSTRING, CSTR() "Race these configurations, comma separated (default: all, e.g. fbbt-nopre,fbbt,fbbt-aggr)"}
+		     ,{'S',  CSTR() "sweep",        0, &sweep,            TTOGGLE, CSTR() "Run all raced configurations to completion and print their stats (default: off)"}
+		     ,{'L',  CSTR() "daemon",       0, &daemonSock,       TSTRING, CSTR() "Solve jobs (options and model, one line) sent to this Unix socket, on Cplex environments kept open (default: none)"}
+		     ,{'J',  CSTR() "jobs",         4, &nJobs,            TINT,    CSTR() "Daemon: workers, each with its own Cplex environment, solving one job at a time (default: 4)"}
 		     ,{'h',  CSTR() "help",       0, &ifHelp,        TTOGGLE, CSTR() "Print this help and exit"}
 		     ,{0,    CSTR() "",           0, NULL,           TTOGGLE, CSTR() ""} // THIS ENTRY ALWAYS AT THE END
   };
@@ -56,28 +87,91 @@ int main (int argc, char **argv) {
 
   filenames = readargs (argc, argv, options);  // parse command line
 
-  if (ifHelp || (argc < 1) || !filenames)
+  // a daemon job neither serves jobs nor races, it is solved here
+
+  if (jobEnv_ && (*daemonSock || (nRace > 1) || *configNames)) {
+    printf ("Warning: --daemon, --race and --configs are ignored in daemon jobs\n");
+    *daemonSock = *configNames = 0;
+    nRace = 0;
+  }
+
+  if (ifHelp || (argc < 1) || (!filenames && !*daemonSock))
     print_help (argv [0], options);
 
-  if (ifHelp || !filenames) {
+  if (ifHelp || (!filenames && !*daemonSock)) {
 
     if (!ifHelp) 
       printf ("No file specified, exiting\n");      
 
-    for (i=0; filenames [i]; ++i)
-      free (filenames [i]);
-    free (filenames);
+    if (filenames) {
+      for (i=0; filenames [i]; ++i)
+	free (filenames [i]);
+      free (filenames);
+    }
+
+    return 0;
+  }
+
+  // daemon: returns here when stopped. Its workers solve each job
+  // with daemonJob, i.e., this function on the job's command line and
+  // the environment the worker keeps open
+
+  if (*daemonSock) {
+
+    daemonRun (daemonSock, nJobs, argv [0], daemonJob);
+
+    if (filenames) {
+      for (i=0; filenames [i]; ++i)
+	free (filenames [i]);
+      free (filenames);
+    }
+
+    free (traceName);
+    free (historyName);
+    free (configNames);
+    free (cacheDir);
+    free (daemonSock);
 
     return 0;
   }
 
+  if (opt.targeted && (opt.cliqueTable || opt.reduce))
+    printf ("Warning: --targeted builds its own FPLP, --cliques and --reduce are ignored\n");
+
+  // racing: the driver returns here once a winner is printed, the
+  // workers go on with their own configuration (without tracing, as
+  // they would all write to the same file)
+
+  if ((nRace > 1) || *configNames) {
+
+    *traceName = 0;
+
+    if (raceRun (nRace, *filenames, *historyName ? historyName : NULL, configNames, sweep,
+		 &addcuts, &presolve, &opt) < 0) {
+
+      for (i=0; filenames [i]; ++i)
+	free (filenames [i]);
+      free (filenames);
+      free (traceName);
+      free (historyName);
+      free (configNames);
+      free (cacheDir);
+      free (daemonSock);
+
+      return 0;
+    }
+  }
+
+  env = jobEnv_ ? jobEnv_ : CPXopenCPLEX (&status);
+
   /* Turn on output to the screen */
 
   if (maxTime > 0)
     status = CPXsetdblparam (env, CPX_PARAM_TILIM,  maxTime);
 
+  status = CPXsetdblparam (env, CPX_PARAM_EPGAP, gap);
+
   status = CPXsetintparam (env, CPX_PARAM_SCRIND, CPX_ON);
-  //status = CPXsetintparam (env, CPX_PARAM_PREIND, CPX_OFF); // turn off presolve. TODO: restore presolve
 
   CPXLPptr mip = CPXcreateprob (env, &status, "cpx+fbbt");
 
@@ -91,20 +185,50 @@ int main (int argc, char **argv) {
 
   status = CPXreadcopyprob (env, mip, *filenames, NULL); /* Read MIP from file */
 
+  opt.budget = NULL; // each separator call has its own
+
+  if (addcuts && *cacheDir)
+    cacheHit = cacheRootBounds (env, mip, cacheDir, &opt, &cacheSaved);
+
+  opt.trace = NULL;
+
+  if (addcuts && *traceName &&
+      (opt.trace = traceOpen (traceName, "wb")))
+    status = CPXsetintparam (env, CPX_PARAM_THREADS, 1); // record a reproducible node sequence
+
   if (addcuts)
     status = CPXsetusercutcallbackfunc (env, fixpointfbbt, &opt);
+
+  if (addcuts && opt.pending &&
+      (CPXsetbranchcallbackfunc     (env, pendingBranch, &opt) ||
+       CPXsetdeletenodecallbackfunc (env, pendingDelete, &opt)))
+    printf ("Warning: could not set callbacks for pending bounds\n");
+
+  // aborts FPLP solves over the budget of their call
+
+  if (addcuts && ((opt.fplpItLimit >= 0) || (opt.fplpItTotal > 0.)) &&
+      CPXsetlpcallbackfunc (env, budgetLPCallback, budgetHandle ()))
+    printf ("Warning: could not set the LP callback, FPLP solves will not be aborted\n");
+
+  if (opt.heurFrequency > 0)
+    status = CPXsetheuristiccallbackfunc (env, fixpropHeur, &opt);
   
-  /*
-    status = CPXsetintparam (env, CPX_PARAM_MIPCBREDLP,
-    CPX_OFF); //UNNECESSARY -- Let MIP callbacks work on the original
-    model, otherwise CPLEX works on the presolved model
+  // Callbacks work on the presolved model: node LP, column types,
+  // cuts, node data and heuristic solutions are all in its space, and
+  // the callbacks check that it is so (see fixpointfbbt)
+
+  status = CPXsetintparam (env, CPX_PARAM_MIPCBREDLP, CPX_ON);
 
+  /*
     status = CPXsetintparam (env, CPX_PARAM_MIPSEARCH,
     CPX_MIPSEARCH_TRADITIONAL); Turn on traditional search for use
     with control callbacks
   */
 
-  if (presolve &&
+  if (!presolve)
+    status = CPXsetintparam (env, CPX_PARAM_PREIND, CPX_OFF);
+
+  else if (
 
       (CPXsetintparam (env, CPX_PARAM_IMPLBD,   (presolve == 1) ?  0 : 2) || /* 0: let Cpx choose, 2: aggressive */
        CPXsetintparam (env, CPX_PARAM_PRESLVND, (presolve == 1) ?  0 : 2) || /* 2: force, 3: force plus probing, 0: let Cplex choose */
@@ -115,6 +239,26 @@ int main (int argc, char **argv) {
 
   status = CPXmipopt (env, mip); /* Optimize the problem and obtain solution */
 
+  // size of the model before and after presolve (the same if there is
+  // no presolved model)
+
+  {
+    CPXCLPptr redlp = NULL;
+
+    if (!CPXgetredlp (env, mip, &redlp)) {
+
+      if (!redlp)
+	redlp = mip;
+
+      printf ("Presolve: %d,%d,%d,%d,%d\n", presolve,
+	      CPXgetnumcols (env, mip),   CPXgetnumrows (env, mip),
+	      CPXgetnumcols (env, redlp), CPXgetnumrows (env, redlp));
+    }
+  }
+
+  if (opt.trace)
+    traceClose (opt.trace);
+
   if (status)
     printf ("Failed to optimize MIP, error code %d\n", status);
   else {
@@ -149,6 +293,9 @@ int main (int argc, char **argv) {
       printf ("Could not retrieve solution");
   }
 
+  if (addcuts && *cacheDir)
+    cacheStats (cacheDir, cacheHit, cacheSaved);
+
   // print first part of the output line
 
   {
@@ -198,6 +345,7 @@ int main (int argc, char **argv) {
     switch (status) {
 
     case CPXMIP_OPTIMAL:         summary = "done";       break;
+    case CPXMIP_OPTIMAL_TOL:     summary = "gap";        break;
     case CPXMIP_INFEASIBLE:      summary = "infeasible"; break;
     case CPXMIP_UNBOUNDED:       summary = "unbounded";  break;
     case CPXMIP_TIME_LIM_FEAS:
@@ -206,14 +354,60 @@ int main (int argc, char **argv) {
     }
 
     printf ("%s,%s\n",summary,ubs);
+
+    if (addcuts && opt.targeted)
+      targetStats ();
+
+    if (addcuts && opt.pending)
+      pendingStats ();
+
+    if (addcuts && opt.reduce)
+      reduceStats ();
+
+    if (addcuts && opt.coefTighten)
+      coefStats ();
+
+    if (addcuts && opt.diffGraph)
+      diffStats ();
+
+    if (addcuts && opt.cliqueTable)
+      cliqueStats ();
+
+    if (addcuts && ((opt.fplpMemory > 0.) || (opt.rssCap > 0.)))
+      chunkStats (&opt);
+
+    if (addcuts && ((opt.fplpItLimit >= 0) || (opt.fplpItTotal > 0.)))
+      budgetStats (&opt);
+
+    if (opt.heurFrequency > 0)
+      fixpropHeur (env, NULL, 0, NULL, NULL, NULL, NULL, NULL);
   }
 
   if (mip != NULL) status = CPXfreeprob    (env, &mip);
-  if (env != NULL) status = CPXcloseCPLEX (&env);
+  if (env != NULL && env != jobEnv_) status = CPXcloseCPLEX (&env); // a daemon worker keeps its own
 
   for (i=0; filenames [i]; ++i)
     free (filenames [i]);
   free (filenames);
+  free (traceName);
+  free (historyName);
+  free (configNames);
+  free (cacheDir);
+  free (daemonSock);
+
+  return status;
+}
+
+/* solve a daemon job with the command line (argc, argv) on env, which
+   its worker keeps open for the next jobs */
+
+static int daemonJob (CPXENVptr env, int argc, char **argv) {
+
+  int status;
+
+  jobEnv_ = env;
+  status  = main (argc, argv);
+  jobEnv_ = NULL;
 
   return status;
 }
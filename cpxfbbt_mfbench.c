@@ -0,0 +1,172 @@
+/*
+ * Fix point FBBT -- time to root bounds, Cplex FPLP vs matrix-free
+ *
+ * For each model file, the root FPLP (original bounds) is solved by
+ * building it and calling CPXlpopt, and by the matrix-free solver.
+ * One line per model is printed:
+ *
+ * mfbench: file,nrows,ncols,nnz,fplpnz,cpxtime,mftime,certified,maxdiff
+ *
+ * where maxdiff is the largest difference between the two sets of
+ * finite bounds (-1 if the matrix-free solver did not certify them).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <sys/time.h>
+
+#include "cplex.h"
+#include "cmdline.h"
+#include "cpxfbbt.h"
+
+static double wallTime () {
+
+  struct timeval tv;
+  gettimeofday (&tv, NULL);
+  return (double) tv. tv_sec + (double) tv. tv_usec / 1e6;
+}
+
+static void benchModel (CPXENVptr env, char *filename, int maxIter, int nThreads) {
+
+  int
+    status, i,
+    ncols, nrows, nnz, suffspace,
+    *mbeg, *mind,
+    certified;
+
+  double
+    *mval, *rlb, *rub, *lb, *ub,
+    *cpxSol, *mfSol,
+    cpxTime, mfTime,
+    maxDiff = -1.;
+
+  char *sense;
+
+  CPXLPptr fplp, lp = CPXcreateprob (env, &status, "mfbench");
+
+  if (!lp || CPXreadcopyprob (env, lp, filename, NULL)) {
+    printf ("Could not read %s\n", filename);
+    if (lp) CPXfreeprob (env, &lp);
+    return;
+  }
+
+  ncols = CPXgetnumcols (env, lp);
+  nrows = CPXgetnumrows (env, lp);
+  nnz   = CPXgetnumnz   (env, lp);
+
+  mbeg   = (int    *) malloc ((1 + nrows) * sizeof (int));
+  mind   = (int    *) malloc (nnz         * sizeof (int));
+  mval   = (double *) malloc (nnz         * sizeof (double));
+  rlb    = (double *) malloc (nrows       * sizeof (double));
+  rub    = (double *) malloc (nrows       * sizeof (double));
+  lb     = (double *) malloc (ncols       * sizeof (double));
+  ub     = (double *) malloc (ncols       * sizeof (double));
+  sense  = (char   *) malloc (nrows       * sizeof (char));
+  cpxSol = (double *) malloc (2 * ncols   * sizeof (double));
+  mfSol  = (double *) malloc (2 * ncols   * sizeof (double));
+
+  status = CPXgetlb     (env, lp, lb,    0, ncols-1);
+  status = CPXgetub     (env, lp, ub,    0, ncols-1);
+  status = CPXgetrhs    (env, lp, rlb,   0, nrows-1);
+  status = CPXgetrngval (env, lp, rub,   0, nrows-1);
+  status = CPXgetsense  (env, lp, sense, 0, nrows-1);
+  status = CPXgetrows   (env, lp, &nnz, mbeg, mind, mval, nnz, &suffspace, 0, nrows-1);
+
+  if (rowBounds (nrows, sense, rlb, rub))
+    nrows = 0;
+
+  // Cplex path: build and solve the FPLP
+
+  cpxTime = wallTime ();
+
+  fplp   = createFPLP (env, ncols, nrows, nnz, mbeg, mind, mval, rlb, rub, lb, ub, 0);
+  status = fplp ? CPXlpopt (env, fplp) : -1;
+
+  if (fplp && (CPXgetstat (env, fplp) == CPX_STAT_OPTIMAL))
+    status = CPXgetx (env, fplp, cpxSol, 0, 2 * ncols - 1);
+  else status = -1;
+
+  cpxTime = wallTime () - cpxTime;
+
+  if (fplp)
+    CPXfreeprob (env, &fplp);
+
+  // matrix-free path
+
+  mfTime    = wallTime ();
+  certified = mfFixpoint (ncols, nrows, nnz, mbeg, mind, mval, rlb, rub, lb, ub, mfSol, maxIter, nThreads);
+  mfTime    = wallTime () - mfTime;
+
+  if (certified && !status) {
+
+    maxDiff = 0.;
+
+    for (i=0; i<2*ncols; i++)
+      if ((fabs (cpxSol [i]) < CPX_INFBOUND) &&
+	  (fabs (mfSol  [i]) < CPX_INFBOUND) &&
+	  (fabs (cpxSol [i] - mfSol [i]) > maxDiff))
+	maxDiff = fabs (cpxSol [i] - mfSol [i]);
+  }
+
+  printf ("mfbench: %s,%d,%d,%d,%g,%g,%g,%d,%g\n",
+	  filename, nrows, ncols, nnz,
+	  fplpNumNz (nrows, nnz, mbeg, rlb, rub),
+	  status ? -1. : cpxTime, mfTime, certified, maxDiff);
+
+  free (mbeg);
+  free (mind);
+  free (mval);
+  free (rlb);
+  free (rub);
+  free (lb);
+  free (ub);
+  free (sense);
+  free (cpxSol);
+  free (mfSol);
+
+  CPXfreeprob (env, &lp);
+}
+
+int main (int argc, char **argv) {
+
+  int status, i, maxIter, nThreads;
+
+  char ifHelp = 0, **filenames;
+
+  CPXENVptr env;
+
+  tpar options [] = {{ 'i',  CSTR() "mfiter",  1e4, &maxIter,  TINT,    CSTR() "Iteration limit of the matrix-free FPLP solver (default: 10000)"}
+		     ,{'j',  CSTR() "threads",   1, &nThreads, TINT,    CSTR() "Threads for the matrix-free FPLP solver (default: 1)"}
+		     ,{'h',  CSTR() "help",      0, &ifHelp,   TTOGGLE, CSTR() "Print this help and exit"}
+		     ,{0,    CSTR() "",          0, NULL,      TTOGGLE, CSTR() ""} // THIS ENTRY ALWAYS AT THE END
+  };
+
+  set_default_args (options);
+
+  filenames = readargs (argc, argv, options);
+
+  if (ifHelp || !filenames) {
+    print_help (argv [0], options);
+    return 0;
+  }
+
+  env = CPXopenCPLEX (&status);
+
+  if (!env) {
+    printf ("Could not open Cplex, error code %d\n", status);
+    return -1;
+  }
+
+  for (i=0; filenames [i]; ++i) {
+    benchModel (env, filenames [i], maxIter, nThreads);
+    free (filenames [i]);
+  }
+
+  free (filenames);
+
+  CPXcloseCPLEX (&env);
+
+  return 0;
+}
@@ -0,0 +1,575 @@
+/*
+ * Fix point FBBT as a cutting plane in Cplex -- matrix-free FPLP solver
+ *
+ * The FPLP is never formed. For row j and z = (xL, xU), let
+ *
+ *   smin_j = sum {a_jk > 0} a_jk xL_k + sum {a_jk < 0} a_jk xU_k
+ *   smax_j = sum {a_jk > 0} a_jk xU_k + sum {a_jk < 0} a_jk xL_k
+ *
+ * then the FPLP rows created by createRow for x_i in row j are
+ *
+ *   smin_j + |a_ji| (xU_i - xL_i) <= rub_j     (if rub_j finite)
+ *   smax_j - |a_ji| (xU_i - xL_i) >= rlb_j     (if rlb_j finite)
+ *
+ * i.e., one pair per nonzero of the original matrix. Both K z and
+ * K^T y are computed in O(nnz) from the original rows, and the FPLP
+ *
+ *   max sum_i (xU_i - xL_i)  s.t.  K z <= h,  lb <= xL, xU <= ub
+ *
+ * is solved with a primal-dual hybrid gradient method (PDLP without
+ * restarts or preconditioning).
+ *
+ * Safeguard: the FPLP feasible set is closed under the join
+ * (min xL, max xU) of two solutions, so its optimum z* contains every
+ * feasible z, and for each i
+ *
+ *   (xU*_i - xU_i) + (xL_i - xL*_i) <= V* - V(z) <= D(y) - V(z) = gap
+ *
+ * where D(y) is the Lagrangian bound of any y >= 0. Hence, if z is
+ * feasible and D(y) is finite, [xL - gap, xU + gap] contains the
+ * fixpoint and is a valid box. Otherwise, or if the gap is too large,
+ * nothing is returned and the caller solves the exact FPLP.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <pthread.h>
+
+#include "cplex.h"
+#include "cpxfbbt.h"
+
+//#define DEBUG
+
+#define COUENNE_INFINITY 1e50
+
+#define MF_FEASTOL     1e-9  /* primal feasibility tolerance of certified points */
+#define MF_GAPTOL      1e-6  /* relative duality gap required for certification  */
+#define MF_CHECK_EVERY 64    /* iterations between convergence checks            */
+#define MF_POWER_ITER  30    /* power iterations to estimate ||K||               */
+#define MF_REPAIR_ITER 50    /* FBBT sweeps to make the final point feasible     */
+#define MF_MIN_WORK    50000 /* do not spawn threads for fewer nonzeros          */
+
+enum mfMode {MF_INIT, MF_POWER, MF_PDHG};
+
+struct mfData_s {
+
+  int ncols, nrows, nnz, nThreads;
+
+  const int    *mbeg, *mind;
+  const double *mval, *rlb, *rub, *lb, *ub;
+
+  int *cbeg, *cpos, *crow; /* column-wise access to the CSR arrays */
+
+  double
+    *xL, *xU,            /* primal iterate z                      */
+    *gL, *gU,            /* K^T y                                 */
+    *yL, *yU,            /* duals, one per nonzero and row side   */
+    *YL, *YU,            /* row sums of the duals                 */
+    *rL, *rU,            /* residual K z - h at the current z     */
+    *rLold, *rUold,      /* residual at the previous z            */
+    tau, sigma;
+
+  enum mfMode mode;
+};
+
+typedef void (*mfKernel) (struct mfData_s *, int, int);
+
+struct mfJob_s {
+
+  struct mfData_s *d;
+  mfKernel kernel;
+  int first, last;
+};
+
+#define ROWEND(d,j) (((j) == (d) -> nrows - 1) ? (d) -> nnz : (d) -> mbeg [(j) + 1])
+
+/*
+ * Row kernel: residuals r = K z - h for rows [first,last), then the
+ * dual step (MF_PDHG) or y = K z (MF_POWER, where h is ignored)
+ */
+
+static void rowKernel (struct mfData_s *d, int first, int last) {
+
+  int j, p;
+
+  double lin = (d -> mode == MF_POWER) ? 0. : 1.;
+
+  for (j=first; j<last; j++) {
+
+    int
+      beg = d -> mbeg [j],
+      end = ROWEND (d, j),
+      hasL = d -> rlb [j] > -COUENNE_INFINITY,
+      hasU = d -> rub [j] <  COUENNE_INFINITY;
+
+    double
+      smin = 0., smax = 0.,
+      YL = 0., YU = 0.;
+
+    for (p=beg; p<end; p++) {
+
+      int    k = d -> mind [p];
+      double a = d -> mval [p];
+
+      if (a > 0.) {smin += a * d -> xL [k]; smax += a * d -> xU [k];}
+      else        {smin += a * d -> xU [k]; smax += a * d -> xL [k];}
+    }
+
+    for (p=beg; p<end; p++) {
+
+      int    k = d -> mind [p];
+      double aw = fabs (d -> mval [p]) * (d -> xU [k] - d -> xL [k]);
+
+      d -> rU [p] = hasU ? smin + aw - lin * d -> rub [j] : 0.;
+      d -> rL [p] = hasL ? lin * d -> rlb [j] - smax + aw : 0.;
+
+      switch (d -> mode) {
+
+      case MF_POWER:
+
+	d -> yU [p] = d -> rU [p];
+	d -> yL [p] = d -> rL [p];
+	break;
+
+      case MF_PDHG:
+
+	d -> yU [p] += d -> sigma * (2. * d -> rU [p] - d -> rUold [p]); if (d -> yU [p] < 0.) d -> yU [p] = 0.;
+	d -> yL [p] += d -> sigma * (2. * d -> rL [p] - d -> rLold [p]); if (d -> yL [p] < 0.) d -> yL [p] = 0.;
+	break;
+
+      default: break;
+      }
+
+      YU += d -> yU [p];
+      YL += d -> yL [p];
+    }
+
+    d -> YU [j] = YU;
+    d -> YL [j] = YL;
+  }
+}
+
+/*
+ * Column kernel: g = K^T y for columns [first,last), then the primal
+ * step z = proj (z - tau (c + g)) if in MF_PDHG mode. The objective
+ * is max sum (xU - xL), i.e., min c^T z with c = (1, -1)
+ */
+
+static void colKernel (struct mfData_s *d, int first, int last) {
+
+  int k, q;
+
+  for (k=first; k<last; k++) {
+
+    double gL = 0., gU = 0.;
+
+    for (q = d -> cbeg [k]; q < d -> cbeg [k+1]; q++) {
+
+      int
+	p = d -> cpos [q],
+	j = d -> crow [q];
+
+      double
+	a    = d -> mval [p],
+	aabs = fabs (a),
+	apos = (a > 0.) ? a  : 0.,
+	aneg = (a < 0.) ? a  : 0.;
+
+      gL += d -> YU [j] * apos - d -> yU [p] * aabs - d -> YL [j] * aneg - d -> yL [p] * aabs;
+      gU += d -> YU [j] * aneg + d -> yU [p] * aabs - d -> YL [j] * apos + d -> yL [p] * aabs;
+    }
+
+    d -> gL [k] = gL;
+    d -> gU [k] = gU;
+
+    if (d -> mode == MF_PDHG) {
+
+      double
+	xL = d -> xL [k] - d -> tau * ( 1. + gL),
+	xU = d -> xU [k] - d -> tau * (-1. + gU);
+
+      if (xL < d -> lb [k]) xL = d -> lb [k]; else if (xL > d -> ub [k]) xL = d -> ub [k];
+      if (xU < d -> lb [k]) xU = d -> lb [k]; else if (xU > d -> ub [k]) xU = d -> ub [k];
+
+      d -> xL [k] = xL;
+      d -> xU [k] = xU;
+    }
+  }
+}
+
+static void *runJob (void *arg) {
+
+  struct mfJob_s *job = (struct mfJob_s *) arg;
+
+  job -> kernel (job -> d, job -> first, job -> last);
+
+  return NULL;
+}
+
+/* run kernel on [0,n) split among d -> nThreads threads */
+
+static void parallelFor (struct mfData_s *d, mfKernel kernel, int n) {
+
+  int t, nT = d -> nThreads;
+
+  pthread_t      *threads;
+  struct mfJob_s *jobs;
+
+  if ((nT <= 1) || (d -> nnz < MF_MIN_WORK) || (n < nT)) {
+    kernel (d, 0, n);
+    return;
+  }
+
+  threads = (pthread_t      *) malloc (nT * sizeof (pthread_t));
+  jobs    = (struct mfJob_s *) malloc (nT * sizeof (struct mfJob_s));
+
+  for (t=0; t<nT; t++) {
+
+    jobs [t]. d      = d;
+    jobs [t]. kernel = kernel;
+    jobs [t]. first  = (int) ((long long) n *  t      / nT);
+    jobs [t]. last   = (int) ((long long) n * (t + 1) / nT);
+
+    if (t < nT - 1)
+      pthread_create (threads + t, NULL, runJob, jobs + t);
+  }
+
+  runJob (jobs + nT - 1);
+
+  for (t=0; t<nT-1; t++)
+    pthread_join (threads [t], NULL);
+
+  free (threads);
+  free (jobs);
+}
+
+/* swap current and previous residuals */
+
+static void swapResiduals (struct mfData_s *d) {
+
+  double *tmp;
+
+  tmp = d -> rL; d -> rL = d -> rLold; d -> rLold = tmp;
+  tmp = d -> rU; d -> rU = d -> rUold; d -> rUold = tmp;
+}
+
+/* largest violation of K z <= h and of lb <= z <= ub at the current
+   z (residuals must be up to date) */
+
+static double primalViolation (struct mfData_s *d) {
+
+  double viol = 0.;
+
+  int p, k;
+
+  for (p=0; p<d->nnz; p++) {
+    if (d -> rU [p] > viol) viol = d -> rU [p];
+    if (d -> rL [p] > viol) viol = d -> rL [p];
+  }
+
+  for (k=0; k<d->ncols; k++) {
+    if (d -> lb [k] - d -> xL [k] > viol) viol = d -> lb [k] - d -> xL [k];
+    if (d -> xU [k] - d -> ub [k] > viol) viol = d -> xU [k] - d -> ub [k];
+    if (d -> lb [k] - d -> xU [k] > viol) viol = d -> lb [k] - d -> xU [k];
+    if (d -> xL [k] - d -> ub [k] > viol) viol = d -> xL [k] - d -> ub [k];
+  }
+
+  return viol;
+}
+
+/* Lagrangian upper bound on the FPLP value, D(y) = h^T y - min_{lb <=
+   z <= ub} (c + K^T y)^T z (g must be up to date). Returns
+   COUENNE_INFINITY if unbounded because of infinite column bounds */
+
+static double dualBound (struct mfData_s *d) {
+
+  double bound = 0., absSum = 0.;
+
+  int j, p, k;
+
+  for (j=0; j<d->nrows; j++)
+    for (p = d -> mbeg [j]; p < ROWEND (d, j); p++) {
+      if (d -> yU [p] > 0.) {bound += d -> rub [j] * d -> yU [p]; absSum += fabs (d -> rub [j] * d -> yU [p]);}
+      if (d -> yL [p] > 0.) {bound -= d -> rlb [j] * d -> yL [p]; absSum += fabs (d -> rlb [j] * d -> yL [p]);}
+    }
+
+  for (k=0; k<d->ncols; k++) {
+
+    double
+      dL =  1. + d -> gL [k],
+      dU = -1. + d -> gU [k],
+      bL = (dL > 0.) ? d -> lb [k] : d -> ub [k],
+      bU = (dU > 0.) ? d -> lb [k] : d -> ub [k];
+
+    if ((fabs (dL) > MF_FEASTOL && fabs (bL) >= CPX_INFBOUND) ||
+	(fabs (dU) > MF_FEASTOL && fabs (bU) >= CPX_INFBOUND))
+      return COUENNE_INFINITY;
+
+    if (fabs (bL) < CPX_INFBOUND) {bound -= dL * bL; absSum += fabs (dL * bL);}
+    if (fabs (bU) < CPX_INFBOUND) {bound -= dU * bU; absSum += fabs (dU * bU);}
+  }
+
+  // safety margin for the rounding errors of the sums above
+
+  return bound + 1e-12 * absSum;
+}
+
+/* one FBBT (Jacobi) sweep on z, shrinking xL_k or xU_k just enough to
+   satisfy each violated FPLP row in which they appear as x_i */
+
+static void repairSweep (struct mfData_s *d) {
+
+  int k, q;
+
+  for (k=0; k<d->ncols; k++) {
+
+    double incL = 0., decU = 0.;
+
+    for (q = d -> cbeg [k]; q < d -> cbeg [k+1]; q++) {
+
+      int    p    = d -> cpos [q];
+      double a    = d -> mval [p],
+	     aabs = fabs (a),
+	     vU   = d -> rU [p] > 0. ? (d -> rU [p] + MF_FEASTOL / 2.) / aabs : 0.,
+	     vL   = d -> rL [p] > 0. ? (d -> rL [p] + MF_FEASTOL / 2.) / aabs : 0.;
+
+      // upper side: the row only contains xU_k (a > 0) or xL_k (a < 0)
+      // lower side: the row only contains xL_k (a > 0) or xU_k (a < 0)
+
+      if (a > 0.) {if (vU > decU) decU = vU; if (vL > incL) incL = vL;}
+      else        {if (vU > incL) incL = vU; if (vL > decU) decU = vL;}
+    }
+
+    d -> xL [k] += incL;
+    d -> xU [k] -= decU;
+  }
+}
+
+int mfFixpoint (int ncols,
+		int nrows,
+		int nnz,
+		const int *mbeg,
+		const int *mind,
+		const double *mval,
+		const double *rlb,
+		const double *rub,
+		const double *lb,
+		const double *ub,
+		double *sol,
+		int maxIter,
+		int nThreads) {
+
+  struct mfData_s d;
+
+  int
+    iter, j, k, p,
+    certified = 0,
+    *cnt;
+
+  double
+    value = 0.,
+    bound = COUENNE_INFINITY,
+    gap   = COUENNE_INFINITY,
+    normK, lambda = 0.;
+
+  if (!ncols || !nnz)
+    return 0;
+
+  d.ncols    = ncols;
+  d.nrows    = nrows;
+  d.nnz      = nnz;
+  d.nThreads = nThreads;
+  d.mbeg     = mbeg;
+  d.mind     = mind;
+  d.mval     = mval;
+  d.rlb      = rlb;
+  d.rub      = rub;
+  d.lb       = lb;
+  d.ub       = ub;
+
+  d.cbeg  = (int    *) calloc (ncols + 1, sizeof (int));
+  d.cpos  = (int    *) malloc (nnz       * sizeof (int));
+  d.crow  = (int    *) malloc (nnz       * sizeof (int));
+  cnt     = (int    *) calloc (ncols,     sizeof (int));
+
+  d.xL    = (double *) malloc (ncols * sizeof (double));
+  d.xU    = (double *) malloc (ncols * sizeof (double));
+  d.gL    = (double *) calloc (ncols,  sizeof (double));
+  d.gU    = (double *) calloc (ncols,  sizeof (double));
+  d.YL    = (double *) calloc (nrows,  sizeof (double));
+  d.YU    = (double *) calloc (nrows,  sizeof (double));
+  d.yL    = (double *) calloc (nnz,    sizeof (double));
+  d.yU    = (double *) calloc (nnz,    sizeof (double));
+  d.rL    = (double *) calloc (nnz,    sizeof (double));
+  d.rU    = (double *) calloc (nnz,    sizeof (double));
+  d.rLold = (double *) calloc (nnz,    sizeof (double));
+  d.rUold = (double *) calloc (nnz,    sizeof (double));
+
+  // column-wise access to the row-wise matrix
+
+  for (p=0; p<nnz; p++)
+    ++d.cbeg [mind [p] + 1];
+
+  for (k=0; k<ncols; k++)
+    d.cbeg [k+1] += d.cbeg [k];
+
+  for (j=0; j<nrows; j++)
+    for (p=mbeg [j]; p<ROWEND (&d, j); p++) {
+      int q = d.cbeg [mind [p]] + cnt [mind [p]]++;
+      d.cpos [q] = p;
+      d.crow [q] = j;
+    }
+
+  free (cnt);
+
+  // estimate ||K|| by power iteration on K^T K
+
+  for (k=0; k<ncols; k++) {
+    d.xL [k] = (double) ((k * 7919) % 199) / 199. - .5;
+    d.xU [k] = (double) ((k * 6271) % 211) / 211. - .5;
+  }
+
+  d.mode = MF_POWER;
+
+  for (iter=0; iter<MF_POWER_ITER; iter++) {
+
+    double nrm = 0.;
+
+    parallelFor (&d, rowKernel, nrows);
+    parallelFor (&d, colKernel, ncols);
+
+    for (k=0; k<ncols; k++)
+      nrm += d.gL [k] * d.gL [k] + d.gU [k] * d.gU [k];
+
+    nrm = sqrt (nrm);
+
+    if (nrm == 0.)
+      break;
+
+    for (k=0; k<ncols; k++) {
+      d.xL [k] = d.gL [k] / nrm;
+      d.xU [k] = d.gU [k] / nrm;
+    }
+
+    lambda = nrm; // ||K^T K v|| with ||v|| = 1
+  }
+
+  normK = 1.1 * sqrt (lambda) + MF_FEASTOL; // power iteration underestimates
+
+  d.tau = d.sigma = .9 / normK;
+
+  // start from the node box (clipped where infinite), y = 0
+
+  for (k=0; k<ncols; k++) {
+
+    double
+      l = (lb [k] > -CPX_INFBOUND) ? lb [k] : (ub [k] < CPX_INFBOUND) ? ub [k] : 0.,
+      u = (ub [k] <  CPX_INFBOUND) ? ub [k] : l;
+
+    d.xL [k] = l;
+    d.xU [k] = u;
+  }
+
+  memset (d.yL, 0, nnz * sizeof (double));
+  memset (d.yU, 0, nnz * sizeof (double));
+  memset (d.gL, 0, ncols * sizeof (double));
+  memset (d.gU, 0, ncols * sizeof (double));
+  memset (d.YL, 0, nrows * sizeof (double));
+  memset (d.YU, 0, nrows * sizeof (double));
+
+  d.mode = MF_INIT;
+  parallelFor (&d, rowKernel, nrows);
+
+  // PDHG iterations
+
+  for (iter=1; iter<=maxIter; iter++) {
+
+    swapResiduals (&d);
+
+    d.mode = MF_PDHG;
+    parallelFor (&d, colKernel, ncols); // g = K^T y, then primal step
+    parallelFor (&d, rowKernel, nrows); // r = K z - h, then dual step
+
+    if (!(iter % MF_CHECK_EVERY) || (iter == maxIter)) {
+
+      d.mode = MF_INIT;
+      parallelFor (&d, colKernel, ncols); // g for the current y, z unchanged
+
+      value = 0.;
+      for (k=0; k<ncols; k++)
+	value += d.xU [k] - d.xL [k];
+
+      bound = dualBound (&d);
+      gap   = bound - value;
+
+#ifdef DEBUG
+      printf ("mf iter %d: value %g bound %g violation %g\n", iter, value, bound, primalViolation (&d));
+#endif
+
+      if ((gap <= MF_GAPTOL * (1. + fabs (value))) &&
+	  (primalViolation (&d) <= 1e3 * MF_FEASTOL))
+	break;
+    }
+  }
+
+  // make z feasible, then certify it with the last dual bound
+
+  d.mode = MF_INIT;
+
+  for (iter=0; iter<MF_REPAIR_ITER; iter++) {
+
+    parallelFor (&d, rowKernel, nrows);
+
+    if (primalViolation (&d) <= MF_FEASTOL)
+      break;
+
+    repairSweep (&d);
+  }
+
+  if ((primalViolation (&d) <= MF_FEASTOL) &&
+      (bound < COUENNE_INFINITY)) {
+
+    value = 0.;
+    for (k=0; k<ncols; k++)
+      value += d.xU [k] - d.xL [k];
+
+    gap = bound - value;
+
+    if (gap < 0.)
+      gap = 0.;
+
+    if (gap <= MF_GAPTOL * (1. + fabs (value))) {
+
+      certified = 1;
+
+      for (k=0; k<ncols; k++) {
+	sol [k]         = (d.xL [k] - gap > lb [k]) ? d.xL [k] - gap : lb [k];
+	sol [ncols + k] = (d.xU [k] + gap < ub [k]) ? d.xU [k] + gap : ub [k];
+      }
+    }
+  }
+
+  if (!certified)
+    printf ("Matrix-free FPLP not certified (gap %g), solving exact FPLP\n", gap);
+
+  free (d.cbeg);
+  free (d.cpos);
+  free (d.crow);
+  free (d.xL);
+  free (d.xU);
+  free (d.gL);
+  free (d.gU);
+  free (d.YL);
+  free (d.YU);
+  free (d.yL);
+  free (d.yU);
+  free (d.rL);
+  free (d.rU);
+  free (d.rLold);
+  free (d.rUold);
+
+  return certified;
+}
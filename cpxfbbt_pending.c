@@ -0,0 +1,258 @@
+/*
+ * Fix point FBBT as a cutting plane in Cplex -- pending bound changes
+ *
+ * A tightened bound that does not cut off the node LP solution is
+ * still valid for the whole subtree. Rather than dropping it, the
+ * separator keeps it in a store attached to the node (as Cplex node
+ * data; the root's store is static). Later separator calls at the node
+ * start from the stored bounds, and add them as local cuts once the
+ * LP solution violates them, without solving the FPLP again. When the
+ * node is branched on, the stored bounds are added to the bound
+ * changes of every child, each of which gets a new, empty store.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cplex.h"
+#include "cpxfbbt.h"
+
+#define COUENNE_EPS 1e-5
+
+/** \struct pending_s
+ *  \brief bound changes proven at a node and not applied yet
+ */
+
+struct pending_s {
+
+  int     n, cap;
+  int    *ind;
+  char   *lu;
+  double *bd;
+};
+
+static struct pending_s root_ = {0, 0, NULL, NULL};
+
+static int
+  nStored_  = 0, // bounds stored
+  nCuts_    = 0, // ... added as local cuts
+  nBranch_  = 0, // ... added to children
+  nSkipped_ = 0; // FPLP solves avoided
+
+static void pendingFree (struct pending_s *p) {
+
+  free (p -> ind);
+  free (p -> lu);
+  free (p -> bd);
+
+  p -> ind = NULL;
+  p -> lu  = NULL;
+  p -> bd  = NULL;
+  p -> n   = p -> cap = 0;
+}
+
+/* store of the current node: the root's, or the node data set when
+   its parent was branched on (NULL if there is none) */
+
+struct pending_s *pendingStore (CPXCENVptr env, void *cbdata, int wherefrom, int depth) {
+
+  void *handle = NULL;
+
+  if (!depth)
+    return &root_;
+
+  if (CPXgetcallbacknodeinfo (env, cbdata, wherefrom, 0, CPX_CALLBACK_INFO_NODE_USERHANDLE, &handle))
+    return NULL;
+
+  return (struct pending_s *) handle;
+}
+
+/* record bound bd ('L' or 'U') on column i, replacing a weaker one */
+
+void pendingAdd (struct pending_s *p, int i, char lu, double bd) {
+
+  int k;
+
+  for (k=0; k < p -> n; k++)
+    if ((p -> ind [k] == i) && (p -> lu [k] == lu)) {
+      if ((lu == 'L') ? (bd > p -> bd [k]) : (bd < p -> bd [k]))
+	p -> bd [k] = bd;
+      return;
+    }
+
+  if (p -> n == p -> cap) {
+    p -> cap = 2 * p -> cap + 16;
+    p -> ind = (int    *) realloc (p -> ind, p -> cap * sizeof (int));
+    p -> lu  = (char   *) realloc (p -> lu,  p -> cap * sizeof (char));
+    p -> bd  = (double *) realloc (p -> bd,  p -> cap * sizeof (double));
+  }
+
+  p -> ind [p -> n] = i;
+  p -> lu  [p -> n] = lu;
+  p -> bd  [p -> n++] = bd;
+
+  ++nStored_;
+}
+
+/* tighten lb and ub with the stored bounds, and add those violated by
+   x as local cuts. Returns the number of cuts added, -1 on error */
+
+int pendingApply (CPXCENVptr env, void *cbdata, int wherefrom,
+		  struct pending_s *p, double *lb, double *ub, const double *x) {
+
+  int k, nCuts = 0;
+
+  double one = 1.;
+
+  for (k=0; k < p -> n; k++) {
+
+    int    i  = p -> ind [k];
+    double bd = p -> bd  [k];
+
+    if (p -> lu [k] == 'L') {
+
+      if (bd > lb [i]) lb [i] = bd;
+
+      if (bd > x [i] + COUENNE_EPS) {
+	if (CPXcutcallbackaddlocal (env, cbdata, wherefrom, 1, bd, 'G', &i, &one)) return -1;
+	++nCuts;
+      }
+
+    } else {
+
+      if (bd < ub [i]) ub [i] = bd;
+
+      if (bd < x [i] - COUENNE_EPS) {
+	if (CPXcutcallbackaddlocal (env, cbdata, wherefrom, 1, bd, 'L', &i, &one)) return -1;
+	++nCuts;
+      }
+    }
+  }
+
+  nCuts_ += nCuts;
+
+  if (nCuts)
+    ++nSkipped_;
+
+  return nCuts;
+}
+
+/* branch callback: create the children proposed by Cplex, with the
+   stored bounds of the node added to each */
+
+int pendingBranch (CPXCENVptr env,
+		   void *cbdata,
+		   int wherefrom,
+		   void *cbhandle,
+		   int brtype,
+		   int sos,
+		   int nodecnt,
+		   int bdcnt,
+		   const int *nodebeg,
+		   const int *indices,
+		   const char *lu,
+		   const double *bd,
+		   const double *nodeest,
+		   int *useraction_p) {
+
+  struct pending_s *p;
+
+  int k, j, l, depth, seqnum,
+    *ind;
+
+  char   *clu;
+  double *cbd;
+
+  *useraction_p = CPX_CALLBACK_DEFAULT;
+
+  if (!nodecnt ||
+      CPXgetcallbacknodeinfo (env, cbdata, wherefrom, 0, CPX_CALLBACK_INFO_NODE_DEPTH, &depth))
+    return 0;
+
+  p = pendingStore (env, cbdata, wherefrom, depth);
+
+  ind = (int    *) malloc ((1 + bdcnt + (p ? p -> n : 0)) * sizeof (int));
+  clu = (char   *) malloc ((1 + bdcnt + (p ? p -> n : 0)) * sizeof (char));
+  cbd = (double *) malloc ((1 + bdcnt + (p ? p -> n : 0)) * sizeof (double));
+
+  for (k=0; k<nodecnt; k++) {
+
+    int
+      first = nodebeg [k],
+      last  = (k == nodecnt - 1) ? bdcnt : nodebeg [k+1],
+      cnt   = 0;
+
+    struct pending_s *child = (struct pending_s *) calloc (1, sizeof (struct pending_s));
+
+    for (j=first; j<last; j++) {
+      ind [cnt]   = indices [j];
+      clu [cnt]   = lu      [j];
+      cbd [cnt++] = bd      [j];
+    }
+
+    // stored bounds, merged with those of the branching on the same column and side
+
+    if (p)
+      for (l=0; l < p -> n; l++) {
+
+	for (j=0; j < last - first; j++)
+	  if ((ind [j] == p -> ind [l]) && (clu [j] == p -> lu [l]))
+	    break;
+
+	if (j < last - first) {
+
+	  if ((clu [j] == 'L') ? (p -> bd [l] > cbd [j]) : (p -> bd [l] < cbd [j]))
+	    cbd [j] = p -> bd [l];
+
+	} else {
+
+	  ind [cnt]   = p -> ind [l];
+	  clu [cnt]   = p -> lu  [l];
+	  cbd [cnt++] = p -> bd  [l];
+	}
+      }
+
+    if (CPXbranchcallbackbranchbds (env, cbdata, wherefrom, cnt, ind, clu, cbd, nodeest [k], child, &seqnum)) {
+      printf ("Could not create child %d of node\n", k);
+      free (child);
+    }
+
+    if (p)
+      nBranch_ += p -> n;
+  }
+
+  if (p)
+    pendingFree (p); // now in the children's bounds
+
+  free (ind);
+  free (clu);
+  free (cbd);
+
+  *useraction_p = CPX_CALLBACK_SET;
+
+  return 0;
+}
+
+/* delete node callback: free the store of a node */
+
+void pendingDelete (CPXCENVptr env,
+		    int wherefrom,
+		    void *cbhandle,
+		    int seqnum,
+		    void *handle) {
+
+  if (handle) {
+    pendingFree ((struct pending_s *) handle);
+    free (handle);
+  }
+}
+
+void pendingStats () {
+
+  printf ("Pending bounds: %d stored, %d added as local cuts, %d added at branching, %d FPLP solves skipped\n",
+	  nStored_, nCuts_, nBranch_, nSkipped_);
+
+  pendingFree (&root_);
+
+  nStored_ = nCuts_ = nBranch_ = nSkipped_ = 0;
+}
@@ -0,0 +1,289 @@
+/*
+ * Fix point FBBT as a cutting plane in Cplex -- probing on binaries
+ *
+ * The FPLP built by fixpointfbbt is reused: a binary x_i is fixed to
+ * 0 and then to 1 by changing the bounds of its columns xL_i and xU_i
+ * only, and the FPLP is re-solved from the previous basis. The two
+ * fixpoint boxes give
+ *
+ * - a fixing of x_i, if one of the two FPLPs is infeasible;
+ * - tighter global bounds, as the union of the two boxes;
+ * - implications x_i = v  ==>  x_j <= u_j^v  (or x_j >= l_j^v).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "cplex.h"
+#include "cpxfbbt.h"
+
+//#define DEBUG
+
+#define true  1
+#define false 0
+
+#define COUENNE_EPS 1e-5
+
+struct probeCand_s {
+
+  int    index;
+  double score;
+};
+
+/* sort candidates by nonincreasing score */
+
+static int compareCand (const void *a, const void *b) {
+
+  double
+    sa = ((const struct probeCand_s *) a) -> score,
+    sb = ((const struct probeCand_s *) b) -> score;
+
+  return (sa < sb) ? 1 : (sa > sb) ? -1 : 0;
+}
+
+/* fix x_i to value in the FPLP and re-solve within the work budget.
+   Returns 1 if the FPLP is optimal (and sol is filled), 0 if it is
+   infeasible, -1 otherwise (or out of budget) */
+
+static int probeSide (CPXCENVptr env, CPXLPptr fplp, int ncols, int i, double value, double *sol, int *itcnt, struct budget_s *work) {
+
+  int
+    ind [2] = {i, ncols + i},
+    status;
+
+  char   lu [2] = {'B', 'B'};
+  double bd [2] = {value, value};
+
+  status = CPXchgbds (env, fplp, 2, ind, lu, bd);
+  status = budgetLPopt (env, fplp, work);
+
+  *itcnt += CPXgetitcnt (env, fplp);
+
+  if (status)
+    return -1;
+
+  status = CPXgetstat (env, fplp);
+
+  if (status == CPX_STAT_OPTIMAL) {
+    CPXgetx (env, fplp, sol, 0, 2 * ncols - 1);
+    return 1;
+  }
+
+  return (status == CPX_STAT_INFEASIBLE) ? 0 : -1;
+}
+
+/* set bounds of both xL_i and xU_i in the FPLP */
+
+static void setBounds (CPXCENVptr env, CPXLPptr fplp, int ncols, int i, double lb, double ub) {
+
+  int    ind [4] = {i,   i,   ncols + i, ncols + i};
+  char   lu  [4] = {'L', 'U', 'L',       'U'};
+  double bd  [4] = {lb,  ub,  lb,        ub};
+
+  CPXchgbds (env, fplp, 4, ind, lu, bd);
+}
+
+/* add bound cut x_j >= bd or x_j <= bd */
+
+static int addBound (CPXCENVptr env, void *cbdata, int wherefrom, int j, double bd, char sense) {
+
+  double one = 1.;
+
+  return CPXcutcallbackadd (env, cbdata, wherefrom, 1, bd, sense, &j, &one, CPX_USECUT_PURGE);
+}
+
+/* add implication x_j + coeI x_i (sense) rhs if violated by x */
+
+static int addImplication (CPXCENVptr env, void *cbdata, int wherefrom, int i, int j, double coeI, double rhs, char sense, const double *x) {
+
+  int    ind [2] = {j, i};
+  double coe [2] = {1., coeI};
+
+  double lhs = x [j] + coeI * x [i];
+
+  if (((sense == 'L') && (lhs < rhs + COUENNE_EPS)) ||
+      ((sense == 'G') && (lhs > rhs - COUENNE_EPS)))
+    return 0;
+
+  return !CPXcutcallbackadd (env, cbdata, wherefrom, 2, rhs, sense, ind, coe, CPX_USECUT_PURGE);
+}
+
+int fplpProbe (CPXCENVptr env,
+	       void *cbdata,
+	       int wherefrom,
+	       CPXLPptr fplp,
+	       int ncols,
+	       int nnz,
+	       const int *mind,
+	       const char *ctype,
+	       const double *lb,
+	       const double *ub,
+	       const double *x,
+	       int budget,
+	       struct budget_s *work,
+	       int *useraction_p) {
+
+  int
+    i, j, k,
+    nCand   = 0,
+    itcnt   = 0,
+    nProbed = 0,
+    nFixed  = 0,
+    nTight  = 0,
+    nImpl   = 0,
+    nCuts   = 0,
+    infeas  = false,
+    *colcnt = (int *) calloc (ncols, sizeof (int));
+
+  double
+    *curLB = (double *) malloc (ncols     * sizeof (double)),
+    *curUB = (double *) malloc (ncols     * sizeof (double)),
+    *sol0  = (double *) malloc (2 * ncols * sizeof (double)),
+    *sol1  = (double *) malloc (2 * ncols * sizeof (double));
+
+  struct probeCand_s *cand = (struct probeCand_s *) malloc (ncols * sizeof (struct probeCand_s));
+
+  for (k=0; k<nnz; k++)
+    ++colcnt [mind [k]];
+
+  for (i=0; i<ncols; i++) {
+
+    curLB [i] = lb [i];
+    curUB [i] = ub [i];
+
+    // candidates are unfixed binaries appearing in some row. Score
+    // favors variables in many rows and fractional in the node LP
+
+    if ((CPX_BINARY == ctype [i]) &&
+	(lb [i] < ub [i] - COUENNE_EPS) &&
+	colcnt [i]) {
+
+      double frac = x [i] - floor (x [i]);
+
+      cand [nCand]. index   = i;
+      cand [nCand++]. score = colcnt [i] * (1. + 2. * ((frac < .5) ? frac : 1. - frac));
+    }
+  }
+
+  qsort (cand, nCand, sizeof (struct probeCand_s), compareCand);
+
+  for (k=0; (k < nCand) && (itcnt < budget) && !infeas && !budgetAborted (work); k++) {
+
+    int r0, r1;
+
+    i = cand [k]. index;
+
+    if (curLB [i] > curUB [i] - COUENNE_EPS) // fixed by a previous probe
+      continue;
+
+    r0 = probeSide (env, fplp, ncols, i, 0., sol0, &itcnt, work);
+    r1 = probeSide (env, fplp, ncols, i, 1., sol1, &itcnt, work);
+
+    setBounds (env, fplp, ncols, i, curLB [i], curUB [i]);
+
+    if ((r0 < 0) || (r1 < 0)) // some solve failed, nothing can be inferred
+      continue;
+
+    ++nProbed;
+
+    if (!r0 && !r1) {
+
+      // both sides infeasible: so is the node. Add contradicting cuts
+
+      printf ("Probing on x%d: both sides infeasible, problem infeasible\n", i);
+
+      addBound (env, cbdata, wherefrom, i, 1., 'G');
+      addBound (env, cbdata, wherefrom, i, 0., 'L');
+
+      nCuts += 2;
+      infeas = true;
+      break;
+    }
+
+    if (!r0 || !r1) {
+
+      // one side infeasible: fix x_i to the other value, here and in the FPLP
+
+      double value = r0 ? 0. : 1.;
+
+#ifdef DEBUG
+      printf ("Probing on x%d: fixed to %g\n", i, value);
+#endif
+
+      if (!addBound (env, cbdata, wherefrom, i, value, r0 ? 'L' : 'G'))
+	++nCuts;
+
+      curLB [i] = curUB [i] = value;
+      setBounds (env, fplp, ncols, i, value, value);
+
+      ++nFixed;
+      continue;
+    }
+
+    // both sides feasible: bounds from the union of the two boxes,
+    // and implications from each box
+
+    for (j=0; j<ncols; j++) {
+
+      double
+	l0 = sol0 [j], u0 = sol0 [ncols + j],
+	l1 = sol1 [j], u1 = sol1 [ncols + j],
+	newL, newU;
+
+      if (j == i)
+	continue;
+
+      if ((CPX_BINARY  == ctype [j]) ||
+	  (CPX_INTEGER == ctype [j])) {
+
+	l0 = ceil  (l0 - COUENNE_EPS); u0 = floor (u0 + COUENNE_EPS);
+	l1 = ceil  (l1 - COUENNE_EPS); u1 = floor (u1 + COUENNE_EPS);
+      }
+
+      newL = (l0 < l1) ? l0 : l1;
+      newU = (u0 > u1) ? u0 : u1;
+
+      if ((newL > curLB [j] + COUENNE_EPS) || (newU < curUB [j] - COUENNE_EPS)) {
+
+	if (newL > curLB [j] + COUENNE_EPS) {if (!addBound (env, cbdata, wherefrom, j, newL, 'G')) ++nCuts; curLB [j] = newL; ++nTight;}
+	if (newU < curUB [j] - COUENNE_EPS) {if (!addBound (env, cbdata, wherefrom, j, newU, 'L')) ++nCuts; curUB [j] = newU; ++nTight;}
+
+#ifdef DEBUG
+	printf ("Probing on x%d: x%d in [%g,%g]\n", i, j, curLB [j], curUB [j]);
+#endif
+
+	setBounds (env, fplp, ncols, j, curLB [j], curUB [j]);
+      }
+
+      if ((curLB [j] <= -CPX_INFBOUND) ||
+	  (curUB [j] >=  CPX_INFBOUND))
+	continue;
+
+      //   x_i = 1  ==>  x_j <= u1:   x_j - (u1 - U) x_i <= U
+      //   x_i = 0  ==>  x_j <= u0:   x_j - (U - u0) x_i <= u0
+      //   x_i = 1  ==>  x_j >= l1:   x_j - (l1 - L) x_i >= L
+      //   x_i = 0  ==>  x_j >= l0:   x_j + (l0 - L) x_i >= l0
+
+      if (u1 < curUB [j] - COUENNE_EPS) {++nImpl; nCuts += addImplication (env, cbdata, wherefrom, i, j, curUB [j] - u1, curUB [j], 'L', x);}
+      if (u0 < curUB [j] - COUENNE_EPS) {++nImpl; nCuts += addImplication (env, cbdata, wherefrom, i, j, u0 - curUB [j], u0,        'L', x);}
+      if (l1 > curLB [j] + COUENNE_EPS) {++nImpl; nCuts += addImplication (env, cbdata, wherefrom, i, j, curLB [j] - l1, curLB [j], 'G', x);}
+      if (l0 > curLB [j] + COUENNE_EPS) {++nImpl; nCuts += addImplication (env, cbdata, wherefrom, i, j, l0 - curLB [j], l0,        'G', x);}
+    }
+  }
+
+  if (nCuts)
+    *useraction_p = CPX_CALLBACK_SET;
+
+  printf ("Probing: %d/%d binaries probed, %d fixed, %d bounds tightened, %d implications, %d cuts, %d iterations\n",
+	  nProbed, nCand, nFixed, nTight, nImpl, nCuts, itcnt);
+
+  free (colcnt);
+  free (curLB);
+  free (curUB);
+  free (sol0);
+  free (sol1);
+  free (cand);
+
+  return nCuts;
+}
@@ -0,0 +1,327 @@
+/*
+ * Fix point FBBT as a cutting plane in Cplex -- configuration racing
+ *
+ * The driver forks one worker per configuration on the same model.
+ * The workers are the parallelism: each runs Cplex with the thread
+ * setting of a plain run, as the callbacks keep their state in
+ * statics. Each worker writes its output to a temporary file. The first worker
+ * whose stats line shows a proven outcome (optimal, within the gap
+ * target, infeasible, unbounded) wins, the others are killed, and the
+ * winner's output is printed. Every race appends a line
+ *
+ *   model,workers,winner,summary,time
+ *
+ * to a history file, so that defaults can be learned per instance
+ * class. The winner is "none" if no worker proved anything; the output
+ * of the last worker to finish is printed then.
+ *
+ * The configurations can be chosen by name (comma separated). In sweep
+ * mode, as a benchmark, no worker is killed: the stats and presolve
+ * lines of every configuration are printed, tagged with its name, and
+ * nothing is recorded in the history.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "cpxfbbt.h"
+
+#define RACE_HISTORY "cpxfbbt_race.hist"
+#define RACE_LINE    4096
+
+/** \struct raceConfig_s
+ *  \brief a configuration raced against the others
+ */
+
+struct raceConfig_s {
+
+  const char *name;
+  char fixpt;     /**< add fixpoint FBBT                   */
+  int  presolve;  /**< 0: off, 1: default, 2: aggressive   */
+  int  maxDepth;  /**< as --maxdepth                       */
+  int  frequency; /**< as --frequency                      */
+};
+
+static const struct raceConfig_s configs_ [] = {{"cplex",       0, 1, -1,  1}
+					       ,{"fbbt",        1, 1, -1,  1}
+					       ,{"fbbt-root",   1, 1,  0,  1}
+					       ,{"fbbt-d10",    1, 1, 10,  1}
+					       ,{"fbbt-stop",   1, 1, -1, -1}
+					       ,{"fbbt-aggr",   1, 2, -1,  1}
+					       ,{"cplex-aggr",  0, 2, -1,  1}
+					       ,{"fbbt-nopre",  1, 0, -1,  1}
+					       ,{"cplex-nopre", 0, 0, -1,  1}
+};
+
+#define RACE_NCONFIGS ((int) (sizeof (configs_) / sizeof (struct raceConfig_s)))
+
+/* indices of the configurations named in the comma separated list
+   names (all of them if empty) into sel. Returns their number, or -1
+   if a name is unknown */
+
+static int raceSelect (const char *names, int *sel) {
+
+  int k, n = 0;
+
+  const char *p = names;
+
+  if (!names || !*names) {
+    for (k=0; k<RACE_NCONFIGS; k++)
+      sel [k] = k;
+    return RACE_NCONFIGS;
+  }
+
+  while (*p) {
+
+    size_t len = strcspn (p, ",");
+
+    for (k=0; k<RACE_NCONFIGS; k++)
+      if ((strlen (configs_ [k]. name) == len) &&
+	  !strncmp (configs_ [k]. name, p, len))
+	break;
+
+    if (k == RACE_NCONFIGS) {
+      printf ("Race: unknown configuration %.*s\n", (int) len, p);
+      return -1;
+    }
+
+    if (n < RACE_NCONFIGS)
+      sel [n++] = k;
+
+    p += len;
+    if (*p) ++p;
+  }
+
+  return n;
+}
+
+/* print the stats and presolve lines of a worker's output, tagged with
+   the name of its configuration */
+
+static void sweepPrint (FILE *out, const char *name, double time) {
+
+  char line [RACE_LINE];
+
+  rewind (out);
+
+  while (fgets (line, RACE_LINE, out))
+    if (!strncmp (line, "Stats:",    6) ||
+	!strncmp (line, "Presolve:", 9))
+      printf ("Sweep %s: %s", name, line);
+
+  printf ("Sweep %s: finished after %g s\n", name, time);
+}
+
+static double wallTime () {
+
+  struct timeval tv;
+  gettimeofday (&tv, NULL);
+  return (double) tv. tv_sec + (double) tv. tv_usec / 1e6;
+}
+
+/* read the summary field (last but one) of the stats line in a
+   worker's output into summary. Returns 1 if it is a proven
+   outcome */
+
+static int raceSummary (FILE *out, char *summary) {
+
+  char line [RACE_LINE];
+
+  strcpy (summary, "failed");
+
+  rewind (out);
+
+  while (fgets (line, RACE_LINE, out))
+
+    if (!strncmp (line, "Stats:", 6)) {
+
+      char
+	*last = strrchr (line, ','),
+	*prev;
+
+      if (!last)
+	continue;
+
+      *last = 0;
+
+      prev = strrchr (line, ',');
+
+      snprintf (summary, 50, "%.49s", prev ? prev + 1 : line);
+    }
+
+  return
+    !strcmp (summary, "done")       ||
+    !strcmp (summary, "gap")        ||
+    !strcmp (summary, "infeasible") ||
+    !strcmp (summary, "unbounded");
+}
+
+/* fork min (nWorkers, #configurations) workers on model, with the
+   configurations in names (all if empty; nWorkers is ignored then). In
+   a worker, apply its configuration to the options and return its
+   index (>= 0) so that the caller solves the model as usual. In the
+   driver, wait for a winner, print its output, record it in the
+   history file (RACE_HISTORY if history is NULL) and return -1. With
+   sweep, wait for all workers and print their stats lines instead */
+
+int raceRun (int nWorkers,
+	     const char *model,
+	     const char *history,
+	     const char *names,
+	     char sweep,
+	     char *addcuts,
+	     int *presolve,
+	     struct option_s *opt) {
+
+  int
+    i, k,
+    nAlive  = 0,
+    winner  = -1,
+    last    = -1,
+    sel [RACE_NCONFIGS];
+
+  pid_t *pids;
+  FILE **outs, *hist;
+
+  char summary [50] = "failed";
+
+  double time0 = wallTime ();
+
+  int nSel = raceSelect (names, sel);
+
+  if (nSel < 0)
+    exit (-1);
+
+  if (names && *names)
+    nWorkers = nSel;
+
+  if (nWorkers > nSel)
+    nWorkers = nSel;
+
+  pids = (pid_t *) malloc (nWorkers * sizeof (pid_t));
+  outs = (FILE **) malloc (nWorkers * sizeof (FILE *));
+
+  fflush (stdout);
+
+  for (k=0; k<nWorkers; k++) {
+
+    if (!(outs [k] = tmpfile ())) {
+      printf ("Race: could not create output file for worker %d\n", k);
+      exit (-1);
+    }
+
+    pids [k] = fork ();
+
+    if (pids [k] < 0) {
+      printf ("Race: could not fork worker %d\n", k);
+      exit (-1);
+    }
+
+    if (!pids [k]) { // worker: apply configuration and solve
+
+      dup2 (fileno (outs [k]), STDOUT_FILENO);
+
+      *addcuts         = configs_ [sel [k]]. fixpt;
+      *presolve        = configs_ [sel [k]]. presolve;
+      opt -> maxDepth  = configs_ [sel [k]]. maxDepth;
+      opt -> frequency = configs_ [sel [k]]. frequency;
+
+      free (pids);
+      free (outs);
+
+      return k;
+    }
+
+    ++nAlive;
+  }
+
+  printf ("%s: %d workers on %s\n", sweep ? "Sweep" : "Race", nWorkers, model);
+
+  while (nAlive) {
+
+    int wstatus;
+
+    pid_t pid = wait (&wstatus);
+
+    if (pid < 0)
+      break;
+
+    for (k=0; (k < nWorkers) && (pids [k] != pid); k++);
+
+    if (k == nWorkers)
+      continue;
+
+    pids [k] = 0;
+    --nAlive;
+    last = k;
+
+    if (sweep) {
+      sweepPrint (outs [k], configs_ [sel [k]]. name, wallTime () - time0);
+      continue;
+    }
+
+    if (raceSummary (outs [k], summary)) {
+      winner = k;
+      break;
+    }
+  }
+
+  // kill the remaining workers
+
+  for (i=0; i<nWorkers; i++)
+    if (pids [i] > 0) {
+      kill    (pids [i], SIGKILL);
+      waitpid (pids [i], NULL, 0);
+    }
+
+  if (sweep) {
+
+    for (k=0; k<nWorkers; k++)
+      fclose (outs [k]);
+
+    free (pids);
+    free (outs);
+
+    return -1;
+  }
+
+  k = (winner >= 0) ? winner : last;
+
+  if (k >= 0) {
+
+    char line [RACE_LINE];
+
+    rewind (outs [k]);
+
+    while (fgets (line, RACE_LINE, outs [k]))
+      fputs (line, stdout);
+  }
+
+  printf ("Race: winner %s (%s) after %g s\n",
+	  (winner >= 0) ? configs_ [sel [winner]]. name : "none",
+	  summary, wallTime () - time0);
+
+  if ((hist = fopen (history ? history : RACE_HISTORY, "a"))) {
+
+    fprintf (hist, "%s,%d,%s,%s,%g\n", model, nWorkers,
+	     (winner >= 0) ? configs_ [sel [winner]]. name : "none",
+	     summary, wallTime () - time0);
+    fclose (hist);
+
+  } else printf ("Race: could not open history file %s\n", history ? history : RACE_HISTORY);
+
+  for (k=0; k<nWorkers; k++)
+    fclose (outs [k]);
+
+  free (pids);
+  free (outs);
+
+  return -1;
+}
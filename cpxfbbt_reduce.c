@@ -0,0 +1,210 @@
+/*
+ * Fix point FBBT as a cutting plane in Cplex -- FPLP reduction
+ *
+ * Deep in the tree many columns are fixed, yet each of them gets two
+ * FPLP columns and an element in every FPLP row of its rows. Before
+ * the FPLP is built, fixed columns are folded into the row bounds: if
+ * the fixed part of row j ranges in [fmin, fmax], the row becomes
+ *
+ *   rlb_j - fmax <= (free part) <= rub_j - fmin
+ *
+ * which is exact for lb == ub and a relaxation otherwise. A side of a
+ * row that is implied by the bounds of its free part gives no
+ * tightening and is dropped, as is a row with no free part or no side
+ * left. The remaining columns are renumbered, and the bounds found are
+ * mapped back; columns in no remaining row keep their bounds.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cplex.h"
+#include "cpxfbbt.h"
+
+#define COUENNE_EPS 1e-5
+#define COUENNE_INFINITY 1e50
+
+static int
+  nCalls_  = 0,
+  nInfeas_ = 0; // calls where a row was found infeasible by its fixed part
+
+static double
+  fullCols_ = 0., redCols_ = 0., // columns, rows, FPLP nonzeros before and after
+  fullRows_ = 0., redRows_ = 0.,
+  fullNz_   = 0., redNz_   = 0.;
+
+/* add a x to [amin, amax] for x in [l,u], with infinities counted
+   apart */
+
+static void addActivity (double a, double l, double u,
+			 double *amin, double *amax, int *nInfMin, int *nInfMax) {
+
+  double
+    lo = (a > 0.) ? l : u,
+    hi = (a > 0.) ? u : l;
+
+  if ((lo <= -CPX_INFBOUND) || (lo >= CPX_INFBOUND)) ++*nInfMin; else *amin += a * lo;
+  if ((hi <= -CPX_INFBOUND) || (hi >= CPX_INFBOUND)) ++*nInfMax; else *amax += a * hi;
+}
+
+/* fixpoint bounds of the given rows and column bounds into sol (xL,
+   then xU), through the FPLP of the reduced rows. Returns true if the
+   bounds in sol are valid */
+
+int reducedBounds (CPXCENVptr env,
+		   struct option_s *options,
+		   int ncols,
+		   int nrows,
+		   int nnz,
+		   const int *mbeg,
+		   const int *mind,
+		   const double *mval,
+		   const double *rlb,
+		   const double *rub,
+		   const double *lb,
+		   const double *ub,
+		   double *sol) {
+
+  int
+    i, j, p,
+    sncols = 0, snrows = 0, snnz = 0,
+    solved = 1,
+    *colMap = (int    *) malloc ((1 + ncols) * sizeof (int)), // column to reduced column, -1 if not there
+    *smbeg  = (int    *) malloc ((1 + nrows) * sizeof (int)),
+    *smind  = (int    *) malloc ((1 + nnz)   * sizeof (int));
+
+  double
+    *smval  = (double *) malloc ((1 + nnz)   * sizeof (double)),
+    *srlb   = (double *) malloc ((1 + nrows) * sizeof (double)),
+    *srub   = (double *) malloc ((1 + nrows) * sizeof (double)),
+    *slb, *sub, *ssol;
+
+  CPXLPptr fplp = NULL;
+
+  char *fixed = (char *) malloc ((1 + ncols) * sizeof (char));
+
+  for (i=0; i<ncols; i++) {
+
+    fixed  [i] = (ub [i] - lb [i] <= COUENNE_EPS);
+    colMap [i] = -1;
+
+    sol [i]         = lb [i];
+    sol [ncols + i] = ub [i];
+  }
+
+  for (j=0; j<nrows; j++) {
+
+    int
+      end  = (j==nrows-1) ? nnz : mbeg [j+1],
+      nFree = 0,
+      fInfMin = 0, fInfMax = 0, // fixed part
+      aInfMin = 0, aInfMax = 0; // free part
+
+    double
+      fmin = 0., fmax = 0.,
+      amin = 0., amax = 0.,
+      l = rlb [j],
+      u = rub [j];
+
+    for (p = mbeg [j]; p < end; p++)
+      if (fixed [mind [p]]) addActivity (mval [p], lb [mind [p]], ub [mind [p]], &fmin, &fmax, &fInfMin, &fInfMax);
+      else {                addActivity (mval [p], lb [mind [p]], ub [mind [p]], &amin, &amax, &aInfMin, &aInfMax); ++nFree;}
+
+    // fold the fixed part into the row bounds
+
+    if (l > -COUENNE_INFINITY) l = fInfMax ? -COUENNE_INFINITY : l - fmax;
+    if (u <  COUENNE_INFINITY) u = fInfMin ?  COUENNE_INFINITY : u - fmin;
+
+    // drop sides implied by the free part
+
+    if (!aInfMin && (amin >= l - COUENNE_EPS)) l = -COUENNE_INFINITY;
+    if (!aInfMax && (amax <= u + COUENNE_EPS)) u =  COUENNE_INFINITY;
+
+    if (!nFree) {
+
+      if ((l > COUENNE_EPS) || (u < -COUENNE_EPS)) // the fixed part alone violates the row
+	solved = 0;
+
+      continue;
+    }
+
+    if ((l <= -COUENNE_INFINITY) && (u >= COUENNE_INFINITY))
+      continue;
+
+    srlb  [snrows]   = l;
+    srub  [snrows]   = u;
+    smbeg [snrows++] = snnz;
+
+    for (p = mbeg [j]; p < end; p++)
+      if (!fixed [mind [p]]) {
+
+	if (colMap [mind [p]] < 0)
+	  colMap [mind [p]] = sncols++;
+
+	smind [snnz]   = colMap [mind [p]];
+	smval [snnz++] = mval [p];
+      }
+  }
+
+  ++nCalls_;
+
+  fullCols_ += ncols;  redCols_ += sncols;
+  fullRows_ += nrows;  redRows_ += snrows;
+  fullNz_   += fplpNumNz (nrows,  nnz,  mbeg,  rlb,  rub);
+  redNz_    += fplpNumNz (snrows, snnz, smbeg, srlb, srub);
+
+  if (!solved)
+    ++nInfeas_;
+
+  else if (snrows) {
+
+    slb  = (double *) malloc ((1 + sncols)     * sizeof (double));
+    sub  = (double *) malloc ((1 + sncols)     * sizeof (double));
+    ssol = (double *) malloc ((1 + 2 * sncols) * sizeof (double));
+
+    for (i=0; i<ncols; i++)
+      if (colMap [i] >= 0) {
+	slb [colMap [i]] = lb [i];
+	sub [colMap [i]] = ub [i];
+      }
+
+    if ((solved = fixpointBounds (env, options, sncols, snrows, snnz, smbeg, smind, smval, srlb, srub, slb, sub, ssol, &fplp)))
+
+      for (i=0; i<ncols; i++)
+	if (colMap [i] >= 0) {
+	  sol [i]         = ssol [colMap [i]];
+	  sol [ncols + i] = ssol [colMap [i] + sncols];
+	}
+
+    if (fplp)
+      CPXfreeprob (env, &fplp);
+
+    free (slb);
+    free (sub);
+    free (ssol);
+  }
+
+  free (colMap);
+  free (fixed);
+  free (smbeg); free (smind); free (smval);
+  free (srlb);  free (srub);
+
+  return solved;
+}
+
+/* print the statistics of the reduced FPLPs, and start them over */
+
+void reduceStats () {
+
+  printf ("Reduced FPLP: %d calls, columns %g of %g, rows %g of %g, FPLP nonzeros %g of %g (%.1f%%), %d infeasible by fixed columns\n",
+	  nCalls_,
+	  nCalls_ ? redCols_ / nCalls_ : 0., nCalls_ ? fullCols_ / nCalls_ : 0.,
+	  nCalls_ ? redRows_ / nCalls_ : 0., nCalls_ ? fullRows_ / nCalls_ : 0.,
+	  redNz_, fullNz_,
+	  (fullNz_ > 0.) ? 100. * redNz_ / fullNz_ : 0.,
+	  nInfeas_);
+
+  nCalls_ = nInfeas_ = 0;
+  fullCols_ = redCols_ = fullRows_ = redRows_ = fullNz_ = redNz_ = 0.;
+}
@@ -0,0 +1,238 @@
+/*
+ * Fix point FBBT -- replay a trace of callback inputs
+ *
+ * Each record of a trace written with --trace is fed through the
+ * same FPLP build and solve path used by the callback, outside of
+ * any MIP search. One line per call is printed:
+ *
+ * replay: call,depth,nrows,ncols,nnz,fplpnz,time,solved,tightL,tightU
+ *
+ * where tightL and tightU count the bounds the callback would have
+ * added as cuts, followed by a summary line. With --check, each record
+ * is also solved with the plain FPLP (no --diffgraph or --cliques),
+ * and the bounds that differ are counted; example_dag.lp is a case for
+ * --diffgraph.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <sys/time.h>
+
+#include "cplex.h"
+#include "cmdline.h"
+#include "cpxfbbt.h"
+
+#define COUENNE_EPS 1e-5
+
+static char check_ = 0; // compare with the plain FPLP
+
+static double wallTime () {
+
+  struct timeval tv;
+  gettimeofday (&tv, NULL);
+  return (double) tv. tv_sec + (double) tv. tv_usec / 1e6;
+}
+
+static void replayTrace (CPXENVptr env, char *filename, struct option_s *opt) {
+
+  struct traceRec_s rec;
+
+  FILE *f = traceOpen (filename, "rb");
+
+  int
+    status, i,
+    nCalls  = 0,
+    nSolved = 0,
+    nTiL = 0,
+    nTiU = 0,
+    nChecked  = 0, // records compared with the plain FPLP
+    nMismatch = 0, // ... solved by one and not the other
+    nDiffer   = 0; // ... bounds differing
+
+  double
+    totTime = 0.,
+    maxTime = 0.;
+
+  if (!f)
+    return;
+
+  memset (&rec, 0, sizeof (struct traceRec_s));
+
+  while ((status = traceRead (f, &rec)) > 0) {
+
+    CPXLPptr fplp = NULL;
+
+    int
+      solved,
+      tiL = 0,
+      tiU = 0;
+
+    double
+      *rlb = (double *) malloc ((rec.nrows + 1) * sizeof (double)),
+      *rub = (double *) malloc ((rec.nrows + 1) * sizeof (double)),
+      *sol = (double *) malloc ((2 * rec.ncols + 1) * sizeof (double)),
+      time0;
+
+    memcpy (rlb, rec.rhs, rec.nrows * sizeof (double));
+    memcpy (rub, rec.rng, rec.nrows * sizeof (double));
+
+    if (rowBounds (rec.nrows, rec.sense, rlb, rub)) {
+      free (rlb);
+      free (rub);
+      free (sol);
+      break;
+    }
+
+    time0  = wallTime ();
+    solved = opt -> cliqueTable ?
+      cliqueBounds   (env, opt, rec.ncols, rec.nrows, rec.nnz, rec.mbeg, rec.mind, rec.mval, rlb, rub, rec.ctype, rec.lb, rec.ub, sol) :
+      fixpointBounds (env, opt, rec.ncols, rec.nrows, rec.nnz, rec.mbeg, rec.mind, rec.mval, rlb, rub, rec.lb, rec.ub, sol, &fplp);
+    time0  = wallTime () - time0;
+
+    if (fplp)
+      CPXfreeprob (env, &fplp);
+
+    // the same record through the plain FPLP
+
+    if (check_ && (opt -> diffGraph || opt -> cliqueTable)) {
+
+      struct option_s plain = *opt;
+
+      double *psol = (double *) malloc ((2 * rec.ncols + 1) * sizeof (double));
+
+      int psolved;
+
+      plain. diffGraph = plain. cliqueTable = 0;
+
+      psolved = fixpointBounds (env, &plain, rec.ncols, rec.nrows, rec.nnz, rec.mbeg, rec.mind, rec.mval, rlb, rub, rec.lb, rec.ub, psol, &fplp);
+
+      if (fplp)
+	CPXfreeprob (env, &fplp);
+
+      ++nChecked;
+
+      if (psolved != solved)
+	++nMismatch;
+
+      else if (solved)
+	for (i=0; i < 2 * rec.ncols; i++)
+	  if (fabs (psol [i] - sol [i]) > COUENNE_EPS * (1. + fabs (psol [i])))
+	    ++nDiffer;
+
+      free (psol);
+    }
+
+    // same criterion used by the callback to add a bound as a cut
+
+    if (solved)
+
+      for (i=0; i<rec.ncols; i++) {
+
+	double
+	  newLB = sol [i],
+	  newUB = sol [rec.ncols + i];
+
+	if ((CPX_BINARY  == rec.ctype [i]) ||
+	    (CPX_INTEGER == rec.ctype [i])) {
+
+	  newLB = ceil  (newLB - COUENNE_EPS);
+	  newUB = floor (newUB + COUENNE_EPS);
+	}
+
+	if ((newLB > rec.x [i] + COUENNE_EPS) && (newLB > rec.lb [i] + COUENNE_EPS)) ++tiL;
+	if ((newUB < rec.x [i] - COUENNE_EPS) && (newUB < rec.ub [i] - COUENNE_EPS)) ++tiU;
+      }
+
+    printf ("replay: %d,%d,%d,%d,%d,%g,%g,%d,%d,%d\n",
+	    ++nCalls, rec.depth, rec.nrows, rec.ncols, rec.nnz,
+	    fplpNumNz (rec.nrows, rec.nnz, rec.mbeg, rlb, rub),
+	    time0, solved, tiL, tiU);
+
+    nSolved += solved;
+    nTiL    += tiL;
+    nTiU    += tiU;
+    totTime += time0;
+
+    if (time0 > maxTime)
+      maxTime = time0;
+
+    free (rlb);
+    free (rub);
+    free (sol);
+  }
+
+  printf ("Replay %s: %d calls, %d solved, time %g (mean %g, max %g), tightened %d lower and %d upper bounds%s\n",
+	  filename, nCalls, nSolved, totTime, nCalls ? totTime / nCalls : 0., maxTime, nTiL, nTiU,
+	  (status < 0) ? " (trace truncated)" : "");
+
+  if (nChecked)
+    printf ("Check %s: %d calls against the plain FPLP, %d solved by only one, %d bounds differ\n",
+	    filename, nChecked, nMismatch, nDiffer);
+
+  traceFreeRec (&rec);
+  fclose (f);
+}
+
+int main (int argc, char **argv) {
+
+  int status, i;
+
+  char ifHelp = 0, **filenames;
+
+  struct option_s opt;
+
+  CPXENVptr env;
+
+  tpar options [] = {{ 'm',  CSTR() "mfthreshold", -1, &opt.mfThreshold,  TINT,    CSTR() "Solve FPLPs with at least this many nonzeros matrix-free (default: -1, never)"}
+		     ,{'i',  CSTR() "mfiter",      1e4, &opt.mfIterations, TINT,    CSTR() "Iteration limit of the matrix-free FPLP solver (default: 10000)"}
+		     ,{'j',  CSTR() "threads",      1, &opt.nThreads,     TINT,    CSTR() "Threads for the matrix-free FPLP solver (default: 1)"}
+		     ,{'D',  CSTR() "diffgraph",    0, &opt.diffGraph,    TTOGGLE, CSTR() "Propagate two-variable difference rows with shortest paths, only the others with the FPLP (default: off)"}
+		     ,{'Q',  CSTR() "cliques",      0, &opt.cliqueTable,  TTOGGLE, CSTR() "Propagate set packing and partitioning rows on a clique table, only the others with the FPLP (default: off)"}
+		     ,{'M',  CSTR() "fplpmem",     -1, &opt.fplpMemory,   TDOUBLE, CSTR() "Memory budget (MB) of one FPLP, larger ones are solved in row chunks (default: -1, no limit)"}
+		     ,{'X',  CSTR() "rsscap",      -1, &opt.rssCap,       TDOUBLE, CSTR() "Keep resident memory below this (MB) when building FPLPs (default: -1, no cap)"}
+		     ,{'K',  CSTR() "check",        0, &check_,           TTOGGLE, CSTR() "With --diffgraph or --cliques, also solve the plain FPLP and count the bounds that differ (default: off)"}
+		     ,{'h',  CSTR() "help",         0, &ifHelp,           TTOGGLE, CSTR() "Print this help and exit"}
+		     ,{0,    CSTR() "",             0, NULL,              TTOGGLE, CSTR() ""} // THIS ENTRY ALWAYS AT THE END
+  };
+
+  memset (&opt, 0, sizeof (struct option_s));
+
+  set_default_args (options);
+
+  filenames = readargs (argc, argv, options);
+
+  if (ifHelp || !filenames) {
+    print_help (argv [0], options);
+    return 0;
+  }
+
+  env = CPXopenCPLEX (&status);
+
+  if (!env) {
+    printf ("Could not open Cplex, error code %d\n", status);
+    return -1;
+  }
+
+  for (i=0; filenames [i]; ++i) {
+    replayTrace (env, filenames [i], &opt);
+    free (filenames [i]);
+  }
+
+  free (filenames);
+
+  if ((opt.fplpMemory > 0.) || (opt.rssCap > 0.))
+    chunkStats (&opt);
+
+  if (opt.diffGraph)
+    diffStats ();
+
+  if (opt.cliqueTable)
+    cliqueStats ();
+
+  CPXcloseCPLEX (&env);
+
+  return 0;
+}
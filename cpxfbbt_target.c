@@ -0,0 +1,326 @@
+/*
+ * Fix point FBBT as a cutting plane in Cplex -- targeted FPLP
+ *
+ * Only bounds that cut off the node LP solution x become cuts, so the
+ * FPLP objective is restricted to candidate columns: fractional
+ * integers, and columns at a bound with nonzero reduced cost. Rows are
+ * restricted to those within a few hops of the candidates (rows of a
+ * candidate are one hop, rows of the other columns of those rows two,
+ * and so on). Dropping rows only weakens the fixpoint, so the bounds
+ * are still valid; and since the feasible set of the FPLP is closed
+ * under union of boxes, maximizing the width of the candidates alone
+ * still gives their fixpoint bounds. Bounds of the other columns of
+ * the restricted FPLP are meaningless and are not returned.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "cplex.h"
+#include "cpxfbbt.h"
+
+#define COUENNE_EPS 1e-5
+
+static char checked_ = 0; // compared with the full FPLP at least once
+
+static int
+  nCalls_  = 0,
+  nCand_   = 0, // candidates
+  nFullR_  = 0, // rows of the full and targeted FPLP base model
+  nTargR_  = 0,
+  nFullC_  = 0, // cut-worthy tightenings of the full FPLP (with --targetcheck)
+  nMissed_ = 0; // ... of which missed by the targeted one
+
+static double
+  fullNz_ = 0., // FPLP nonzeros, full and targeted
+  targNz_ = 0.;
+
+/* whether the bounds of column i in sol would be added as cuts */
+
+static void cutWorthy (const double *sol, int ncols, int i,
+		       const char *ctype, const double *lb, const double *ub, const double *x,
+		       char *cutL, char *cutU) {
+
+  double
+    l = sol [i],
+    u = sol [ncols + i];
+
+  if ((CPX_BINARY  == ctype [i]) ||
+      (CPX_INTEGER == ctype [i])) {
+
+    l = ceil  (l - COUENNE_EPS);
+    u = floor (u + COUENNE_EPS);
+  }
+
+  *cutL = (l > x [i] + COUENNE_EPS) && (l > lb [i] + COUENNE_EPS);
+  *cutU = (u < x [i] - COUENNE_EPS) && (u < ub [i] - COUENNE_EPS);
+}
+
+/* fixpoint bounds of the candidate columns into sol (xL, then xU),
+   with the bounds of the other columns set to [lb, ub]. Returns true
+   if the bounds in sol are valid */
+
+int targetedBounds (CPXCENVptr env,
+		    struct option_s *options,
+		    CPXCLPptr nodeLP,
+		    int ncols,
+		    int nrows,
+		    int nnz,
+		    const int *mbeg,
+		    const int *mind,
+		    const double *mval,
+		    const double *rlb,
+		    const double *rub,
+		    const double *lb,
+		    const double *ub,
+		    const char *ctype,
+		    const double *x,
+		    double *sol) {
+
+  int
+    i, j, p, hop,
+    nCand = 0,
+    sncols = 0, snrows = 0, snnz = 0,
+    solved = 0,
+    *colMap = (int *) malloc ((1 + ncols) * sizeof (int)), // column to subproblem column, -1 if not there
+    *cbeg   = (int *) calloc ((2 + ncols),  sizeof (int)),
+    *crow   = (int *) malloc ((1 + nnz)   * sizeof (int)),
+    *smbeg, *smind, *ind;
+
+  char
+    *cand   = (char *) calloc (ncols + 1, sizeof (char)),
+    *colSel = (char *) calloc (ncols + 1, sizeof (char)),
+    *rowSel = (char *) calloc (nrows + 1, sizeof (char));
+
+  double
+    budget,
+    *dj = (double *) malloc ((1 + ncols) * sizeof (double)),
+    *smval, *srlb, *srub, *slb, *sub, *ssol, *zero;
+
+  CPXLPptr fplp = NULL;
+
+  // candidates
+
+  if (CPXgetdj (env, nodeLP, dj, 0, ncols-1))
+    memset (dj, 0, ncols * sizeof (double));
+
+  for (i=0; i<ncols; i++) {
+
+    char
+      isInt   = (CPX_BINARY == ctype [i]) || (CPX_INTEGER == ctype [i]),
+      atBound = (x [i] < lb [i] + COUENNE_EPS) || (x [i] > ub [i] - COUENNE_EPS);
+
+    if ((isInt && (fabs (x [i] - floor (x [i] + .5)) > COUENNE_EPS)) ||
+	(atBound && (fabs (dj [i]) > COUENNE_EPS) && (lb [i] < ub [i]))) {
+
+      cand [i] = colSel [i] = 1;
+      ++nCand;
+    }
+
+    sol [i]         = lb [i];
+    sol [ncols + i] = ub [i];
+  }
+
+  ++nCalls_;
+  nCand_ += nCand;
+
+  if (!nCand) { // nothing to tighten
+
+    free (colMap); free (cbeg); free (crow);
+    free (cand);   free (colSel); free (rowSel);
+    free (dj);
+    return 1;
+  }
+
+  // rows of each column
+
+  for (p=0; p<nnz; p++)
+    ++cbeg [mind [p] + 1];
+
+  for (i=0; i<ncols; i++) {
+    cbeg [i+1] += cbeg [i];
+    colMap [i] = cbeg [i];
+  }
+
+  for (j=0; j<nrows; j++)
+    for (p = mbeg [j]; p < ((j == nrows-1) ? nnz : mbeg [j+1]); p++)
+      crow [colMap [mind [p]]++] = j;
+
+  // rows within targetHops hops of the candidates; colSel marks the
+  // columns reached so far, colMap the current frontier
+
+  for (i=0; i<ncols; i++)
+    colMap [i] = cand [i];
+
+  for (hop = 0; (hop < options -> targetHops) || !hop; hop++) {
+
+    for (i=0; i<ncols; i++)
+      if (colMap [i] > 0)
+	for (p = cbeg [i]; p < cbeg [i+1]; p++)
+	  if (!rowSel [crow [p]])
+	    rowSel [crow [p]] = 2; // new in this hop
+
+    memset (colMap, 0, ncols * sizeof (int));
+
+    for (j=0; j<nrows; j++)
+      if (rowSel [j] == 2) {
+
+	rowSel [j] = 1;
+
+	for (p = mbeg [j]; p < ((j == nrows-1) ? nnz : mbeg [j+1]); p++)
+	  if (!colSel [mind [p]])
+	    colSel [mind [p]] = colMap [mind [p]] = 1;
+      }
+  }
+
+  // subproblem
+
+  for (i=0; i<ncols; i++)
+    colMap [i] = colSel [i] ? sncols++ : -1;
+
+  for (j=0; j<nrows; j++)
+    if (rowSel [j]) {
+      ++snrows;
+      snnz += ((j == nrows-1) ? nnz : mbeg [j+1]) - mbeg [j];
+    }
+
+  smbeg = (int    *) malloc ((1 + snrows) * sizeof (int));
+  smind = (int    *) malloc ((1 + snnz)   * sizeof (int));
+  smval = (double *) malloc ((1 + snnz)   * sizeof (double));
+  srlb  = (double *) malloc ((1 + snrows) * sizeof (double));
+  srub  = (double *) malloc ((1 + snrows) * sizeof (double));
+  slb   = (double *) malloc ((1 + sncols) * sizeof (double));
+  sub   = (double *) malloc ((1 + sncols) * sizeof (double));
+  ssol  = (double *) malloc ((1 + 2 * sncols) * sizeof (double));
+  ind   = (int    *) malloc ((1 + 2 * sncols) * sizeof (int));
+  zero  = (double *) calloc ((1 + 2 * sncols),  sizeof (double));
+
+  for (snrows = snnz = j = 0; j<nrows; j++)
+    if (rowSel [j]) {
+
+      srlb  [snrows]   = rlb [j];
+      srub  [snrows]   = rub [j];
+      smbeg [snrows++] = snnz;
+
+      for (p = mbeg [j]; p < ((j == nrows-1) ? nnz : mbeg [j+1]); p++) {
+	smind [snnz]   = colMap [mind [p]];
+	smval [snnz++] = mval [p];
+      }
+    }
+
+  for (i=0; i<ncols; i++)
+    if (colMap [i] >= 0) {
+      slb [colMap [i]] = lb [i];
+      sub [colMap [i]] = ub [i];
+    }
+
+  nFullR_ += nrows;
+  nTargR_ += snrows;
+  fullNz_ += fplpNumNz (nrows,  nnz,  mbeg,  rlb,  rub);
+  targNz_ += fplpNumNz (snrows, snnz, smbeg, srlb, srub);
+
+  // FPLP with zero objective on the non-candidates, or the whole
+  // fixpoint in chunks if even the restricted FPLP is over budget
+
+  if ((options -> fplpMemory > 0. || options -> rssCap > 0.) &&
+      ((budget = fplpBudget (options)) >= 0.) &&
+      (fplpMemory (sncols, snrows, snnz, smbeg, srlb, srub) > budget)) {
+
+    if ((solved = chunkedFixpoint (env, sncols, snrows, snnz, smbeg, smind, smval, srlb, srub, slb, sub, ssol, budget, options -> budget)))
+      for (i=0; i<ncols; i++)
+	if (cand [i]) {
+	  sol [i]         = ssol [colMap [i]];
+	  sol [ncols + i] = ssol [colMap [i] + sncols];
+	}
+
+    fplp = NULL;
+
+  } else if (budgetBuild (options -> budget, fplpNumNz (snrows, snnz, smbeg, srlb, srub)))
+    fplp = createFPLP (env, sncols, snrows, snnz, smbeg, smind, smval, srlb, srub, slb, sub, 0);
+
+  for (i=p=0; i<ncols; i++)
+    if ((colMap [i] >= 0) && !cand [i]) {
+      ind [p++] = colMap [i];
+      ind [p++] = colMap [i] + sncols;
+    }
+
+  if (fplp && p)
+    CPXchgobj (env, fplp, p, ind, zero);
+
+  if (fplp &&
+      !budgetLPopt (env, fplp, options -> budget) &&
+      (CPXgetstat (env, fplp) == CPX_STAT_OPTIMAL) &&
+      !CPXgetx (env, fplp, ssol, 0, 2 * sncols - 1)) {
+
+    solved = 1;
+
+    for (i=0; i<ncols; i++)
+      if (cand [i]) {
+	sol [i]         = ssol [colMap [i]];
+	sol [ncols + i] = ssol [colMap [i] + sncols];
+      }
+  }
+
+  if (fplp)
+    CPXfreeprob (env, &fplp);
+
+  // compare with the full FPLP
+
+  if (options -> targetCheck && solved) {
+
+    double *fullSol = (double *) malloc (2 * ncols * sizeof (double));
+
+    CPXLPptr full = NULL;
+
+    checked_ = 1;
+
+    if (fixpointBounds (env, options, ncols, nrows, nnz, mbeg, mind, mval, rlb, rub, lb, ub, fullSol, &full))
+
+      for (i=0; i<ncols; i++) {
+
+	char fL, fU, tL, tU;
+
+	cutWorthy (fullSol, ncols, i, ctype, lb, ub, x, &fL, &fU);
+	cutWorthy (sol,     ncols, i, ctype, lb, ub, x, &tL, &tU);
+
+	nFullC_  += fL + fU;
+	nMissed_ += (fL && !tL) + (fU && !tU);
+      }
+
+    if (full)
+      CPXfreeprob (env, &full);
+
+    free (fullSol);
+  }
+
+  free (colMap); free (cbeg);  free (crow);
+  free (cand);   free (colSel); free (rowSel);
+  free (dj);
+  free (smbeg);  free (smind); free (smval);
+  free (srlb);   free (srub);
+  free (slb);    free (sub);   free (ssol);
+  free (ind);    free (zero);
+
+  return solved;
+}
+
+/* print the statistics of the targeted FPLPs, and start them over */
+
+void targetStats () {
+
+  printf ("Targeted FPLP: %d calls, %g candidates/call, rows %d of %d, FPLP nonzeros %g of %g (%.1f%%)",
+	  nCalls_, nCalls_ ? (double) nCand_ / nCalls_ : 0.,
+	  nTargR_, nFullR_, targNz_, fullNz_,
+	  (fullNz_ > 0.) ? 100. * targNz_ / fullNz_ : 0.);
+
+  if (checked_)
+    printf (", missed %d of %d tightenings", nMissed_, nFullC_);
+
+  printf ("\n");
+
+  nCalls_ = nCand_ = nFullR_ = nTargR_ = nFullC_ = nMissed_ = 0;
+  fullNz_ = targNz_ = 0.;
+  checked_ = 0;
+}
@@ -0,0 +1,303 @@
+/*
+ * Fix point FBBT -- capture and replay of the callback inputs
+ *
+ * A trace is a header ("FPTR" and a format version) followed by one
+ * record per callback call:
+ *
+ *   int    depth, ncols, nrows, nnz, keep
+ *   char   newCtype;  if nonzero: char ctype [ncols]
+ *   double lb [ncols], ub [ncols], x [ncols]
+ *   char   sense [nrows]
+ *   double rhs [nrows], rng [nrows]
+ *   int    len  [nrows - keep]
+ *   int    mind [nnz - mbeg [keep]]
+ *   double mval [nnz - mbeg [keep]]
+ *
+ * The first keep rows are identical to those of the previous record
+ * (the node LP mostly changes by cuts added at the bottom), so only
+ * the rows after them are stored. Column types are only stored when
+ * they change.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cplex.h"
+#include "cpxfbbt.h"
+
+#define TRACE_MAGIC   "FPTR"
+#define TRACE_VERSION 1
+
+/* writer state: last record's matrix and column types */
+
+static int
+  prevNcols_ = -1,
+  prevNrows_ = 0,
+  *prevMbeg_ = NULL,
+  *prevMind_ = NULL,
+  writeErr_  = 0;
+
+static double *prevMval_  = NULL;
+static char   *prevCtype_ = NULL;
+
+#define ROWEND(mbeg,nrows,nnz,j) (((j) == (nrows) - 1) ? (nnz) : (mbeg) [(j) + 1])
+
+static void writeArr (FILE *f, const void *ptr, size_t size, size_t n) {
+
+  if (n && (fwrite (ptr, size, n, f) != n) && !writeErr_++)
+    printf ("Error writing trace\n");
+}
+
+static int readArr (FILE *f, void *ptr, size_t size, size_t n) {
+
+  return !n || (fread (ptr, size, n, f) == n);
+}
+
+/* open trace for writing (mode "wb") or reading ("rb"), and write or
+   validate its header. Returns NULL on failure */
+
+FILE *traceOpen (const char *filename, const char *mode) {
+
+  FILE *f = fopen (filename, mode);
+
+  char magic [4];
+  int  version = TRACE_VERSION;
+
+  if (!f) {
+    printf ("Could not open trace %s\n", filename);
+    return NULL;
+  }
+
+  if (*mode == 'w') {
+
+    writeArr (f, TRACE_MAGIC, 1,           4);
+    writeArr (f, &version,    sizeof (int), 1);
+
+  } else if (!readArr (f, magic,    1,            4) ||
+	     !readArr (f, &version, sizeof (int), 1) ||
+	     strncmp (magic, TRACE_MAGIC, 4) ||
+	     (version != TRACE_VERSION)) {
+
+    printf ("%s is not a version %d FBBT trace\n", filename, TRACE_VERSION);
+    fclose (f);
+    return NULL;
+  }
+
+  return f;
+}
+
+void traceWrite (FILE *f,
+		 int depth,
+		 int ncols,
+		 int nrows,
+		 int nnz,
+		 const int *mbeg,
+		 const int *mind,
+		 const double *mval,
+		 const char *sense,
+		 const double *rhs,
+		 const double *rng,
+		 const double *lb,
+		 const double *ub,
+		 const double *x,
+		 const char *ctype) {
+
+  int
+    j, keep = 0,
+    first,
+    header [5],
+    *len;
+
+  char newCtype;
+
+  // leading rows unchanged since the previous record
+
+  while ((keep < nrows) &&
+	 (keep < prevNrows_)) {
+
+    int
+      beg  = mbeg [keep],
+      size = ROWEND (mbeg, nrows, nnz, keep) - beg;
+
+    if ((prevMbeg_ [keep]     != beg) ||
+	(prevMbeg_ [keep + 1] != beg + size) ||
+	memcmp (prevMind_ + beg, mind + beg, size * sizeof (int)) ||
+	memcmp (prevMval_ + beg, mval + beg, size * sizeof (double)))
+      break;
+
+    ++keep;
+  }
+
+  first = (keep < nrows) ? mbeg [keep] : nnz;
+
+  newCtype = (ncols != prevNcols_) || memcmp (prevCtype_, ctype, ncols);
+
+  header [0] = depth;
+  header [1] = ncols;
+  header [2] = nrows;
+  header [3] = nnz;
+  header [4] = keep;
+
+  writeArr (f, header,    sizeof (int), 5);
+  writeArr (f, &newCtype, 1,            1);
+
+  if (newCtype)
+    writeArr (f, ctype, 1, ncols);
+
+  writeArr (f, lb,    sizeof (double), ncols);
+  writeArr (f, ub,    sizeof (double), ncols);
+  writeArr (f, x,     sizeof (double), ncols);
+  writeArr (f, sense, 1,               nrows);
+  writeArr (f, rhs,   sizeof (double), nrows);
+  writeArr (f, rng,   sizeof (double), nrows);
+
+  len = (int *) malloc ((nrows - keep + 1) * sizeof (int));
+
+  for (j=keep; j<nrows; j++)
+    len [j - keep] = ROWEND (mbeg, nrows, nnz, j) - mbeg [j];
+
+  writeArr (f, len,          sizeof (int),    nrows - keep);
+  writeArr (f, mind + first, sizeof (int),    nnz - first);
+  writeArr (f, mval + first, sizeof (double), nnz - first);
+
+  free (len);
+
+  // save this record's matrix for the next delta
+
+  prevMbeg_  = (int    *) realloc (prevMbeg_,  (nrows + 1) * sizeof (int));
+  prevMind_  = (int    *) realloc (prevMind_,  (nnz   + 1) * sizeof (int));
+  prevMval_  = (double *) realloc (prevMval_,  (nnz   + 1) * sizeof (double));
+  prevCtype_ = (char   *) realloc (prevCtype_, (ncols + 1) * sizeof (char));
+
+  memcpy (prevMbeg_,  mbeg,  nrows * sizeof (int));
+  memcpy (prevMind_,  mind,  nnz   * sizeof (int));
+  memcpy (prevMval_,  mval,  nnz   * sizeof (double));
+  memcpy (prevCtype_, ctype, ncols);
+
+  prevMbeg_ [nrows] = nnz;
+
+  prevNrows_ = nrows;
+  prevNcols_ = ncols;
+}
+
+/* close a trace opened for writing, and free the writer's state */
+
+void traceClose (FILE *f) {
+
+  fclose (f);
+
+  free (prevMbeg_);
+  free (prevMind_);
+  free (prevMval_);
+  free (prevCtype_);
+
+  prevMbeg_  = prevMind_ = NULL;
+  prevMval_  = NULL;
+  prevCtype_ = NULL;
+  prevNrows_ = 0;
+  prevNcols_ = -1;
+}
+
+/* read next record into rec, which holds the previous record (or is
+   zeroed for the first one). Returns 1 on success, 0 at the end of
+   the trace, -1 if the trace is corrupt */
+
+int traceRead (FILE *f, struct traceRec_s *rec) {
+
+  int
+    j, header [5],
+    first, keep, nrows, ncols, nnz;
+
+  char newCtype;
+
+  if (!readArr (f, header, sizeof (int), 5))
+    return 0;
+
+  ncols = header [1];
+  nrows = header [2];
+  nnz   = header [3];
+  keep  = header [4];
+
+  if ((ncols < 0) || (nrows < 0) || (nnz < 0) ||
+      (keep  < 0) || (keep > nrows) || (keep > rec -> nrows) ||
+      !readArr (f, &newCtype, 1, 1) ||
+      (!newCtype && (ncols != rec -> ncols))) {
+
+    printf ("Corrupt trace record\n");
+    return -1;
+  }
+
+  first = (keep < rec -> nrows) ? rec -> mbeg [keep] : rec -> nnz;
+
+  if (first > nnz) {
+    printf ("Corrupt trace record\n");
+    return -1;
+  }
+
+  rec -> depth = header [0];
+  rec -> ncols = ncols;
+  rec -> nrows = nrows;
+  rec -> nnz   = nnz;
+
+  rec -> ctype = (char   *) realloc (rec -> ctype, (ncols + 1) * sizeof (char));
+  rec -> lb    = (double *) realloc (rec -> lb,    (ncols + 1) * sizeof (double));
+  rec -> ub    = (double *) realloc (rec -> ub,    (ncols + 1) * sizeof (double));
+  rec -> x     = (double *) realloc (rec -> x,     (ncols + 1) * sizeof (double));
+  rec -> sense = (char   *) realloc (rec -> sense, (nrows + 1) * sizeof (char));
+  rec -> rhs   = (double *) realloc (rec -> rhs,   (nrows + 1) * sizeof (double));
+  rec -> rng   = (double *) realloc (rec -> rng,   (nrows + 1) * sizeof (double));
+  rec -> mbeg  = (int    *) realloc (rec -> mbeg,  (nrows + 1) * sizeof (int));
+  rec -> mind  = (int    *) realloc (rec -> mind,  (nnz   + 1) * sizeof (int));
+  rec -> mval  = (double *) realloc (rec -> mval,  (nnz   + 1) * sizeof (double));
+
+  if ((newCtype && !readArr (f, rec -> ctype, 1, ncols)) ||
+      !readArr (f, rec -> lb,    sizeof (double), ncols) ||
+      !readArr (f, rec -> ub,    sizeof (double), ncols) ||
+      !readArr (f, rec -> x,     sizeof (double), ncols) ||
+      !readArr (f, rec -> sense, 1,               nrows) ||
+      !readArr (f, rec -> rhs,   sizeof (double), nrows) ||
+      !readArr (f, rec -> rng,   sizeof (double), nrows) ||
+      !readArr (f, rec -> mbeg + keep + 1, sizeof (int), nrows - keep)) {
+
+    printf ("Truncated trace record\n");
+    return -1;
+  }
+
+  // row lengths to row starts
+
+  rec -> mbeg [keep] = first;
+
+  for (j=keep; j<nrows; j++)
+    rec -> mbeg [j+1] += rec -> mbeg [j];
+
+  if ((rec -> mbeg [nrows] != nnz) ||
+      !readArr (f, rec -> mind + first, sizeof (int),    nnz - first) ||
+      !readArr (f, rec -> mval + first, sizeof (double), nnz - first)) {
+
+    printf ("Corrupt trace record\n");
+    return -1;
+  }
+
+  for (j=first; j<nnz; j++)
+    if ((rec -> mind [j] < 0) || (rec -> mind [j] >= ncols)) {
+      printf ("Corrupt trace record\n");
+      return -1;
+    }
+
+  return 1;
+}
+
+void traceFreeRec (struct traceRec_s *rec) {
+
+  free (rec -> mbeg);
+  free (rec -> mind);
+  free (rec -> mval);
+  free (rec -> rhs);
+  free (rec -> rng);
+  free (rec -> lb);
+  free (rec -> ub);
+  free (rec -> x);
+  free (rec -> sense);
+  free (rec -> ctype);
+}